@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace core {
+
+	// 32 bit reference to something in a HandlePool, with the slot's index in the low bits and its generation in the
+	// high ones. Removing something bumps its slot's generation, so old handles to it stop resolving instead of finding
+	// whatever gets the slot next. That holds until the same slot has been reused 4095 times. 0 is never handed out.
+	// Tag keeps handles into different pools from being mixed up.
+	template <typename Tag>
+	struct Handle {
+		static constexpr uint32_t INDEX_BITS = 20;
+		static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+		static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+		uint32_t value = 0;
+
+		uint32_t index() const { return value & INDEX_MASK; }
+		uint32_t generation() const { return value >> INDEX_BITS; }
+		bool valid() const { return value != 0; }
+
+		bool operator==(const Handle& other) const = default;
+	};
+
+	// Owns Ts and hands out handles to them, reusing freed slots first.
+	// Slots are reserved up front, so nothing moves until it's removed, and generations live in an array of their own,
+	// so checking a handle only touches 4 bytes of it. Safe from any thread, but a reference from get is only good until
+	// its handle is removed.
+	template <typename T, typename Tag>
+	class HandlePool {
+	public:
+		using HandleType = Handle<Tag>;
+
+		HandlePool(const char* name, uint32_t capacity) : _name(name), _capacity(capacity)
+		{
+			if (capacity > HandleType::INDEX_MASK + 1)
+			{
+				throw std::runtime_error(std::string(name) + " pool is too big for its handles.");
+			}
+
+			_items.reserve(capacity);
+			_generations.reserve(capacity);
+		}
+
+		HandlePool& operator=(const HandlePool& other) = delete;
+		HandlePool(const HandlePool& other) = delete;
+
+		HandleType add(T&& item)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			uint32_t index;
+			if (!_free.empty())
+			{
+				index = _free.back();
+				_free.pop_back();
+				_items[index].emplace(std::move(item));
+			}
+			else
+			{
+				if (_items.size() == _capacity)
+				{
+					throw std::runtime_error(std::string(_name) + " pool is full (" + std::to_string(_capacity) + ").");
+				}
+
+				index = static_cast<uint32_t>(_items.size());
+				_items.emplace_back(std::move(item));
+				_generations.push_back(1);
+			}
+
+			_size++;
+			return { (_generations[index] << HandleType::INDEX_BITS) | index };
+		}
+
+		// Throws if the handle's been removed, i.e. on use after free.
+		T& get(HandleType handle)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return *_items[this->check(handle)];
+		}
+
+		bool contains(HandleType handle)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			uint32_t index = handle.index();
+			return handle.valid() && index < _generations.size() && _generations[index] == handle.generation();
+		}
+
+		// Hands the item back, e.g. to be destroyed once the GPU is done with it. Every handle to it is dead straight away.
+		T remove(HandleType handle)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			uint32_t index = this->check(handle);
+
+			T item = std::move(*_items[index]);
+			this->free_slot(index);
+
+			return item;
+		}
+
+		// Hands back everything that's left, e.g. on shutdown.
+		std::vector<T> remove_all()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			std::vector<T> items;
+			items.reserve(_size);
+			for (uint32_t index = 0; index < _items.size(); index++)
+			{
+				if (_items[index].has_value())
+				{
+					items.push_back(std::move(*_items[index]));
+					this->free_slot(index);
+				}
+			}
+
+			return items;
+		}
+
+		uint32_t size()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _size;
+		}
+
+	private:
+		uint32_t check(HandleType handle)
+		{
+			uint32_t index = handle.index();
+			if (!handle.valid() || index >= _generations.size() || _generations[index] != handle.generation())
+			{
+				throw std::runtime_error(std::string(_name) + " handle " + std::to_string(handle.value) + " is stale or was never handed out.");
+			}
+
+			return index;
+		}
+
+		void free_slot(uint32_t index)
+		{
+			_items[index].reset();
+
+			// Skips 0 when it wraps, so no handle is ever 0.
+			uint32_t generation = (_generations[index] + 1) & HandleType::GENERATION_MASK;
+			_generations[index] = generation != 0 ? generation : 1;
+
+			_free.push_back(index);
+			_size--;
+		}
+
+		const char* _name;
+		uint32_t _capacity;
+
+		std::mutex _mutex;
+		std::vector<std::optional<T>> _items;
+		std::vector<uint32_t> _generations;
+		std::vector<uint32_t> _free;
+		uint32_t _size = 0;
+	};
+
+}
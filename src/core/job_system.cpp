@@ -0,0 +1,350 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::optional<core::JobSystem> core::JobSystem::instance = std::nullopt;
+
+const uint32_t NOT_A_WORKER = UINT32_MAX;
+
+// Which job system's worker the current thread is, if any.
+thread_local core::JobSystem* thread_job_system = nullptr;
+thread_local uint32_t thread_worker_index = NOT_A_WORKER;
+
+// Times an idle worker looks for work before going to sleep. Keeps it around for the next fork in the same frame.
+const uint32_t IDLE_SPINS = 64;
+
+// Best effort, there's no hard affinity on every platform.
+void pin_current_thread(uint32_t cpu)
+{
+#if defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (cpu % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % CPU_SETSIZE, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)cpu;
+#endif
+}
+
+void core::JobSystem::initialize(const JobSystemSettings& settings)
+{
+	JobSystem::instance.emplace(settings);
+}
+
+void core::JobSystem::shutdown()
+{
+	JobSystem::instance.reset();
+}
+
+core::JobSystem& core::JobSystem::get()
+{
+	if (!JobSystem::instance.has_value())
+	{
+		throw std::runtime_error("Job system not initialized.");
+	}
+
+	return JobSystem::instance.value();
+}
+
+core::JobSystem::JobSystem(const JobSystemSettings& settings)
+{
+	// hardware_concurrency can be 0 when it isn't known.
+	uint32_t threads = settings.threads != 0 ? settings.threads : std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (uint32_t i = 0; i < threads; i++)
+	{
+		_deques.push_back(std::make_unique<Deque>());
+	}
+
+	thread_job_system = this;
+	thread_worker_index = 0;
+	if (settings.pin_threads)
+	{
+		pin_current_thread(0);
+	}
+
+	bool pin = settings.pin_threads;
+	for (uint32_t i = 1; i < threads; i++)
+	{
+		_workers.emplace_back([this, i, pin]()
+		{
+			if (pin)
+			{
+				pin_current_thread(i);
+			}
+			this->worker_main(i);
+		});
+	}
+}
+
+core::JobSystem::~JobSystem()
+{
+	_running.store(false, std::memory_order_release);
+	{
+		std::lock_guard lock(_sleep_lock);
+	}
+	_wake.notify_all();
+
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+
+	// Nobody can be waiting on these anymore.
+	for (std::unique_ptr<Deque>& deque : _deques)
+	{
+		while (Job* job = deque->steal())
+		{
+			delete job;
+		}
+	}
+	for (Job* job : _shared_jobs)
+	{
+		delete job;
+	}
+
+	if (thread_job_system == this)
+	{
+		thread_job_system = nullptr;
+		thread_worker_index = NOT_A_WORKER;
+	}
+}
+
+void core::JobSystem::run(std::function<void()> fn, JobCounter& counter)
+{
+	Job* job = new Job{ std::move(fn), &counter };
+	counter._pending.fetch_add(1, std::memory_order_acq_rel);
+
+	if (thread_job_system == this)
+	{
+		// Too much queued up already, it may as well run now.
+		if (!_deques[thread_worker_index]->push(job))
+		{
+			this->execute(job);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard lock(_shared_lock);
+		_shared_jobs.push_back(job);
+		_shared_count.fetch_add(1, std::memory_order_release);
+	}
+
+	this->wake_worker();
+}
+
+void core::JobSystem::wait(JobCounter& counter)
+{
+	uint32_t index = thread_job_system == this ? thread_worker_index : NOT_A_WORKER;
+
+	while (!counter.done())
+	{
+		if (Job* job = this->find_job(index))
+		{
+			this->execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(counter._error_lock);
+		std::swap(error, counter._error);
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void core::JobSystem::worker_main(uint32_t index)
+{
+	thread_job_system = this;
+	thread_worker_index = index;
+
+	uint32_t idle = 0;
+	while (_running.load(std::memory_order_acquire))
+	{
+		// Read before looking, so a job pushed after we looked is guaranteed to move it on.
+		uint64_t epoch = _epoch.load();
+
+		if (Job* job = this->find_job(index))
+		{
+			this->execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock(_sleep_lock);
+		_sleeping.fetch_add(1);
+		_wake.wait(lock, [&]() { return _epoch.load() != epoch || !_running.load(std::memory_order_acquire); });
+		_sleeping.fetch_sub(1);
+		idle = 0;
+	}
+}
+
+core::JobSystem::Job* core::JobSystem::find_job(uint32_t index)
+{
+	if (index != NOT_A_WORKER)
+	{
+		if (Job* job = _deques[index]->pop())
+		{
+			return job;
+		}
+	}
+
+	if (_shared_count.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard lock(_shared_lock);
+		if (!_shared_jobs.empty())
+		{
+			Job* job = _shared_jobs.back();
+			_shared_jobs.pop_back();
+			_shared_count.fetch_sub(1, std::memory_order_release);
+			return job;
+		}
+	}
+
+	// Start with the next worker along, so thieves don't all pile onto worker 0.
+	uint32_t count = this->thread_count();
+	uint32_t start = index != NOT_A_WORKER ? index + 1 : 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t victim = (start + i) % count;
+		if (victim == index)
+		{
+			continue;
+		}
+
+		if (Job* job = _deques[victim]->steal())
+		{
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void core::JobSystem::execute(Job* job)
+{
+	JobCounter* counter = job->counter;
+
+	try
+	{
+		job->fn();
+	}
+	catch (...)
+	{
+		std::lock_guard lock(counter->_error_lock);
+		if (!counter->_error)
+		{
+			counter->_error = std::current_exception();
+		}
+	}
+
+	delete job;
+
+	// The waiter can destroy the counter as soon as this lands.
+	counter->_pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void core::JobSystem::wake_worker()
+{
+	_epoch.fetch_add(1);
+
+	// A worker that's asleep holds the lock from checking the epoch until it's waiting, so taking it here means the
+	// notify can't land in between.
+	if (_sleeping.load() > 0)
+	{
+		{
+			std::lock_guard lock(_sleep_lock);
+		}
+		_wake.notify_one();
+	}
+}
+
+bool core::JobSystem::Deque::push(Job* job)
+{
+	int64_t bottom = _bottom.load(std::memory_order_relaxed);
+	int64_t top = _top.load(std::memory_order_acquire);
+	if (bottom - top >= CAPACITY)
+	{
+		return false;
+	}
+
+	// Release, so whoever sees the new bottom sees the job too.
+	_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	_bottom.store(bottom + 1, std::memory_order_release);
+
+	return true;
+}
+
+core::JobSystem::Job* core::JobSystem::Deque::pop()
+{
+	// Claiming the bottom has to be ordered before reading the top, and against thieves doing the opposite.
+	int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+	_bottom.store(bottom, std::memory_order_seq_cst);
+	int64_t top = _top.load(std::memory_order_seq_cst);
+
+	if (top > bottom)
+	{
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = _jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+	// Last one left, so race the thieves for it.
+	if (top == bottom)
+	{
+		if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+core::JobSystem::Job* core::JobSystem::Deque::steal()
+{
+	int64_t top = _top.load(std::memory_order_seq_cst);
+	int64_t bottom = _bottom.load(std::memory_order_seq_cst);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	Job* job = _jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+
+	return job;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+	struct JobSystemSettings {
+		// Threads including the one that initializes the job system. 0 is one per hardware thread.
+		uint32_t threads = 0;
+		// Pins the initializing thread to the first core and each worker to the next, so the scheduler doesn't move
+		// them around. Off by default since it fights with anything else running on the machine.
+		bool pin_threads = false;
+	};
+
+	// How many jobs run() has started that haven't finished yet. Whoever waits on it gets the first exception any of
+	// them threw.
+	class JobCounter {
+	public:
+		JobCounter() = default;
+
+		JobCounter& operator=(const JobCounter& other) = delete;
+		JobCounter(const JobCounter& other) = delete;
+
+		bool done() { return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> _pending = 0;
+
+		std::mutex _error_lock;
+		std::exception_ptr _error;
+	};
+
+	// A fixed set of worker threads that every subsystem hands work to, instead of starting threads of its own.
+	// Each worker has its own deque: it pushes and pops jobs at the bottom, and idle workers steal from the top of
+	// somebody else's. Threads that aren't workers queue onto a shared list that every worker checks.
+	// The thread that initializes it counts as worker 0, but only runs jobs while it's waiting on a counter.
+	class JobSystem {
+	public:
+		static void initialize(const JobSystemSettings& settings = {});
+		static void shutdown();
+		static JobSystem& get();
+		static bool initialized() { return JobSystem::instance.has_value(); }
+
+		JobSystem(const JobSystemSettings& settings);
+		~JobSystem();
+
+		JobSystem& operator=(const JobSystem& other) = delete;
+		JobSystem(const JobSystem& other) = delete;
+
+		// Queues the job and counts it against counter, which has to outlive it.
+		void run(std::function<void()> job, JobCounter& counter);
+		// Runs queued jobs until everything counted against counter is done, then rethrows the first exception.
+		// Safe to call from inside a job, which is how jobs fork and join.
+		void wait(JobCounter& counter);
+
+		// Including the initializing thread.
+		uint32_t thread_count() { return static_cast<uint32_t>(_deques.size()); }
+
+	private:
+		struct Job {
+			std::function<void()> fn;
+			JobCounter* counter;
+		};
+
+		// Chase-Lev work stealing deque. Only the owner pushes and pops, anyone can steal.
+		class Deque {
+		public:
+			static constexpr int64_t CAPACITY = 4096;
+
+			// False when full.
+			bool push(Job* job);
+			Job* pop();
+			Job* steal();
+
+		private:
+			alignas(64) std::atomic<int64_t> _top = 0;
+			alignas(64) std::atomic<int64_t> _bottom = 0;
+			std::atomic<Job*> _jobs[CAPACITY] = {};
+		};
+
+		void worker_main(uint32_t index);
+		Job* find_job(uint32_t index);
+		void execute(Job* job);
+		void wake_worker();
+
+		std::vector<std::unique_ptr<Deque>> _deques;
+		std::vector<std::thread> _workers;
+
+		std::mutex _shared_lock;
+		std::vector<Job*> _shared_jobs;
+		std::atomic<uint32_t> _shared_count = 0;
+
+		// Idle workers sleep until the epoch moves on. Pushers only touch the lock when somebody is asleep.
+		std::mutex _sleep_lock;
+		std::condition_variable _wake;
+		std::atomic<uint64_t> _epoch = 0;
+		std::atomic<uint32_t> _sleeping = 0;
+		std::atomic<bool> _running = true;
+
+		static std::optional<JobSystem> instance;
+	};
+
+}
@@ -0,0 +1,71 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "core/job_system.h"
+
+uint32_t core::worker_count()
+{
+	return JobSystem::initialized() ? JobSystem::get().thread_count() : 1;
+}
+
+void core::parallel_for(uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)>& fn)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grain = std::max(grain, 1u);
+	uint32_t ranges = std::min((count + grain - 1) / grain, worker_count());
+	if (ranges == 1)
+	{
+		fn(0, count);
+		return;
+	}
+
+	// Spread the remainder over the first few ranges rather than making the last one short.
+	uint32_t per_range = count / ranges;
+	uint32_t remainder = count % ranges;
+
+	JobSystem& jobs = JobSystem::get();
+	JobCounter counter;
+
+	uint32_t begin = 0;
+	for (uint32_t i = 0; i + 1 < ranges; i++)
+	{
+		uint32_t end = begin + per_range + (i < remainder ? 1 : 0);
+		jobs.run([&fn, begin, end]() { fn(begin, end); }, counter);
+		begin = end;
+	}
+
+	// The calling thread takes the last range instead of sitting idle. The jobs reference fn, so they have to be
+	// waited on even if it throws.
+	std::exception_ptr error;
+	try
+	{
+		fn(begin, count);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	try
+	{
+		jobs.wait(counter);
+	}
+	catch (...)
+	{
+		if (!error)
+		{
+			error = std::current_exception();
+		}
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
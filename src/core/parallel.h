@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace core {
+
+	// How many threads parallel_for spreads work over, including the calling one. 1 without a JobSystem.
+	uint32_t worker_count();
+
+	// Splits [0, count) into contiguous ranges of at least grain items, one per worker at most, and calls fn(begin, end)
+	// for each as a job on the JobSystem, with the calling thread taking one range and then helping with the rest.
+	// Returns when all of them are done, rethrowing the first exception any of them threw.
+	// Runs inline when there's only one range.
+	void parallel_for(uint32_t count, uint32_t grain, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+}
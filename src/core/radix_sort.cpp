@@ -0,0 +1,66 @@
+#include "radix_sort.h"
+
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+const int RADIX_BITS = 8;
+const int RADIX_PASSES = 64 / RADIX_BITS;
+const size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+
+void core::radix_sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& key_scratch, std::vector<uint32_t>& value_scratch)
+{
+	if (keys.size() != values.size())
+	{
+		throw std::runtime_error("Radix sort needs a value for every key.");
+	}
+
+	size_t count = keys.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	key_scratch.resize(count);
+	value_scratch.resize(count);
+
+	// Every pass's histogram in one read over the keys.
+	std::array<std::array<uint32_t, RADIX_BUCKETS>, RADIX_PASSES> histograms = {};
+	for (uint64_t key : keys)
+	{
+		for (int pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+	for (int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		int shift = pass * RADIX_BITS;
+		std::array<uint32_t, RADIX_BUCKETS>& histogram = histograms[pass];
+
+		// Every key has the same byte here, so this pass wouldn't move anything.
+		if (histogram[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count)
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram)
+		{
+			uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t destination = histogram[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			key_scratch[destination] = keys[i];
+			value_scratch[destination] = values[i];
+		}
+
+		std::swap(keys, key_scratch);
+		std::swap(values, value_scratch);
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace core {
+
+	// Sorts keys ascending and moves values along with them. Stable LSD radix sort a byte at a time, skipping bytes
+	// every key agrees on, so keys that only use their top bits cost a couple of passes rather than 8.
+	// The scratch vectors are only there so callers can hang onto the memory between sorts. Any of the four may come
+	// back with a different buffer than it went in with.
+	void radix_sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& key_scratch, std::vector<uint32_t>& value_scratch);
+
+}
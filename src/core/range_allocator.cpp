@@ -0,0 +1,89 @@
+#include "range_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+core::RangeAllocator::RangeAllocator(uint32_t capacity) : _capacity(capacity), _free_space(capacity)
+{
+	if (capacity != 0)
+	{
+		_free_ranges[0] = capacity;
+	}
+}
+
+std::optional<uint32_t> core::RangeAllocator::allocate(uint32_t size)
+{
+	if (size == 0)
+	{
+		return std::nullopt;
+	}
+
+	for (auto it = _free_ranges.begin(); it != _free_ranges.end(); it++)
+	{
+		auto [offset, range_size] = *it;
+		if (range_size < size)
+		{
+			continue;
+		}
+
+		_free_ranges.erase(it);
+		if (range_size > size)
+		{
+			_free_ranges[offset + size] = range_size - size;
+		}
+
+		_free_space -= size;
+		return offset;
+	}
+
+	return std::nullopt;
+}
+
+void core::RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	if (offset + size > _capacity)
+	{
+		throw std::runtime_error("Freed range is out of bounds.");
+	}
+
+	_free_space += size;
+
+	auto next = _free_ranges.lower_bound(offset);
+
+	// Merge with the range after us...
+	if (next != _free_ranges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		next = _free_ranges.erase(next);
+	}
+
+	// ...and the one before us.
+	if (next != _free_ranges.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			return;
+		}
+	}
+
+	_free_ranges[offset] = size;
+}
+
+uint32_t core::RangeAllocator::largest_free_range()
+{
+	uint32_t largest = 0;
+	for (auto& [offset, size] : _free_ranges)
+	{
+		largest = std::max(largest, size);
+	}
+
+	return largest;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace core {
+
+	// Hands out ranges of [0, capacity). Units are whatever the caller wants them to be - vertices, indices, bytes.
+	// First fit over an offset-ordered free list, with neighbours merged back together on free.
+	class RangeAllocator {
+	public:
+		RangeAllocator(uint32_t capacity);
+
+		std::optional<uint32_t> allocate(uint32_t size);
+		void free(uint32_t offset, uint32_t size);
+
+		uint32_t capacity() { return _capacity; }
+		uint32_t free_space() { return _free_space; }
+		uint32_t largest_free_range();
+
+	private:
+		uint32_t _capacity;
+		uint32_t _free_space;
+
+		// Offset -> size.
+		std::map<uint32_t, uint32_t> _free_ranges;
+	};
+
+}
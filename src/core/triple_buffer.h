@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace core {
+
+	// Hands the latest value from one writer thread to one reader thread, without either ever waiting on the other.
+	// The writer fills the back slot and publishes it by swapping it with the middle one, the reader swaps the middle
+	// one for its front slot whenever something new was published. Anything published in between is skipped.
+	template <typename T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() = default;
+
+		TripleBuffer& operator=(const TripleBuffer& other) = delete;
+		TripleBuffer(const TripleBuffer& other) = delete;
+
+		// Writer only.
+		T& back() { return _slots[_back].value; }
+		void publish()
+		{
+			uint8_t previous = _middle.exchange(_back | FRESH, std::memory_order_acq_rel);
+			_back = previous & INDEX_MASK;
+		}
+
+		// Reader only. Picks up the newest published value if there is one, returning whether there was.
+		bool update()
+		{
+			if ((_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+			{
+				return false;
+			}
+
+			uint8_t previous = _middle.exchange(_front, std::memory_order_acq_rel);
+			_front = previous & INDEX_MASK;
+			return true;
+		}
+		const T& front() { return _slots[_front].value; }
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 3;
+		static constexpr uint8_t FRESH = 4;
+
+		// Own cache lines, so the two threads don't fight over them.
+		struct Slot {
+			alignas(64) T value = {};
+		};
+
+		Slot _slots[3];
+		alignas(64) std::atomic<uint8_t> _middle = 1;
+		alignas(64) uint8_t _back = 0;
+		alignas(64) uint8_t _front = 2;
+	};
+
+}
@@ -1,14 +1,28 @@
 #include "logger.h"
 
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 #include <GLFW/glfw3.h>
 
 std::optional<Logger> Logger::instance = std::nullopt;
 
+// Each logger gets a new id, so a thread can tell if its cached state belongs to a logger that's since been replaced.
+std::atomic<uint64_t> next_logger_id = 1;
+
+thread_local uint64_t thread_logger_id = 0;
+thread_local void* thread_logger_state = nullptr;
+
 void Logger::initialize()
 {
-	Logger::instance = Logger();
+	Logger::instance.emplace();
+}
+
+void Logger::shutdown()
+{
+	Logger::instance.reset();
 }
 
 Logger& Logger::get()
@@ -21,9 +35,289 @@ Logger& Logger::get()
 	return Logger::instance.value();
 }
 
+Logger::Logger() : _id(next_logger_id.fetch_add(1))
+{
+	_writer = std::thread([this]()
+						  { this->run(); });
+}
+
+Logger::~Logger()
+{
+	_running.store(false);
+	this->wake_writer();
+	_writer.join();
+
+	// Pick up anything logged while the writer was shutting down, and whatever is still suppressed.
+	this->drain(true);
+}
+
+Logger::ThreadState* Logger::thread_state()
+{
+	if (thread_logger_id == _id)
+	{
+		return static_cast<ThreadState*>(thread_logger_state);
+	}
+
+	// First message from this thread. This is the only time the logging path takes a lock.
+	std::lock_guard guard(_threads_lock);
+
+	ThreadState* state = nullptr;
+	size_t count = _thread_count.load(std::memory_order_relaxed);
+	if (count < MAX_THREADS)
+	{
+		_threads[count] = std::make_unique<ThreadState>();
+		state = _threads[count].get();
+		_thread_count.store(count + 1, std::memory_order_release);
+	}
+
+	thread_logger_id = _id;
+	thread_logger_state = state;
+
+	return state;
+}
+
+Logger::Message* Logger::begin_message(ThreadState* state)
+{
+	uint64_t head = state->head.load(std::memory_order_relaxed);
+	if (head - state->tail.load(std::memory_order_acquire) == RING_CAPACITY)
+	{
+		state->dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	return &state->ring[head % RING_CAPACITY];
+}
+
+uint64_t hash_message(const char* text, size_t length)
+{
+	// FNV-1a.
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<unsigned char>(text[i]);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// Looks a few slots ahead so a burst of unique messages doesn't evict the one that's actually repeating.
+// Falls back to replacing the nearby slot that has seen the fewest repeats.
+template <typename Slots>
+auto& find_rate_limit_slot(Slots& slots, uint64_t hash)
+{
+	const size_t PROBE_COUNT = 4;
+
+	size_t victim = hash % slots.size();
+	for (size_t i = 0; i < PROBE_COUNT; i++)
+	{
+		size_t idx = (hash + i) % slots.size();
+		if (slots[idx].hash == hash)
+		{
+			return slots[idx];
+		}
+
+		auto& candidate = slots[idx];
+		auto& current = slots[victim];
+		if (candidate.count < current.count || (candidate.count == current.count && candidate.window_start < current.window_start))
+		{
+			victim = idx;
+		}
+	}
+
+	return slots[victim];
+}
+
+void Logger::commit_message(ThreadState* state, Message* message, LogLevel level, size_t length)
+{
+	uint64_t hash = hash_message(message->text, length);
+	auto now = std::chrono::steady_clock::now();
+
+	bool suppressed = false;
+	bool first_suppressed = false;
+	{
+		std::lock_guard guard(state->rate_limit_lock);
+
+		RateLimitSlot& slot = find_rate_limit_slot(state->rate_limits, hash);
+		if (slot.hash != hash || now - slot.window_start >= RATE_LIMIT_WINDOW)
+		{
+			// The writer hasn't got round to reporting the old window yet, so it's handed over rather than lost.
+			if (slot.suppressed != 0)
+			{
+				state->evicted.push_back(slot);
+			}
+
+			slot.hash = hash;
+			slot.window_start = now;
+			slot.count = 0;
+			slot.suppressed = 0;
+			slot.level = level;
+			slot.length = static_cast<uint32_t>(std::min(length, sizeof(slot.text)));
+			std::memcpy(slot.text, message->text, slot.length);
+		}
+
+		slot.count++;
+		if (slot.count > RATE_LIMIT_BURST)
+		{
+			suppressed = true;
+			first_suppressed = slot.suppressed++ == 0;
+		}
+	}
+
+	if (suppressed)
+	{
+		// The writer might be waiting with no deadline, so it needs telling there's a window to report once it's over.
+		if (first_suppressed)
+		{
+			this->wake_writer();
+		}
+		return;
+	}
+
+	message->level = level;
+	message->length = length;
+
+	// Sequentially consistent, paired with the writer going idle in run(). Only the first message after that wakes it.
+	state->head.store(state->head.load(std::memory_order_relaxed) + 1);
+	if (_writer_idle.load())
+	{
+		this->wake_writer();
+	}
+}
+
+const char* level_prefix(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Verbose:
+		return "[verbose] ";
+	case LogLevel::Debug:
+		return "[debug] ";
+	case LogLevel::Warning:
+		return "[warning] ";
+	case LogLevel::Error:
+		return "[error] ";
+	default:
+		return "";
+	}
+}
+
+void Logger::write_direct(LogLevel level, std::string_view text)
+{
+	std::lock_guard guard(_direct_lock);
+	fmt::print("{}{}\n", level_prefix(level), text);
+	std::fflush(stdout);
+}
+
+void append_suppressed(std::string& out, LogLevel level, const char* text, uint32_t length, uint32_t suppressed)
+{
+	fmt::format_to(std::back_inserter(out), "{}{} (suppressed {} repeats)\n", level_prefix(level), std::string_view(text, length), suppressed);
+}
+
+std::optional<std::chrono::steady_clock::time_point> Logger::drain(bool everything)
+{
+	std::string out;
+	std::optional<std::chrono::steady_clock::time_point> next_report;
+	auto now = std::chrono::steady_clock::now();
+
+	size_t count = _thread_count.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count; i++)
+	{
+		ThreadState* state = _threads[i].get();
+
+		uint64_t tail = state->tail.load(std::memory_order_relaxed);
+		uint64_t head = state->head.load(std::memory_order_acquire);
+
+		for (; tail != head; tail++)
+		{
+			Message& message = state->ring[tail % RING_CAPACITY];
+			out += level_prefix(message.level);
+			out.append(message.text, message.length);
+			out += '\n';
+		}
+
+		state->tail.store(tail, std::memory_order_release);
+
+		uint64_t dropped = state->dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped != 0)
+		{
+			fmt::format_to(std::back_inserter(out), "[warning] Logger dropped {} messages.\n", dropped);
+		}
+
+		// Repeats are reported once their window is over, whether or not the message ever shows up again.
+		std::lock_guard guard(state->rate_limit_lock);
+
+		for (RateLimitSlot& slot : state->evicted)
+		{
+			append_suppressed(out, slot.level, slot.text, slot.length, slot.suppressed);
+		}
+		state->evicted.clear();
+
+		for (RateLimitSlot& slot : state->rate_limits)
+		{
+			if (slot.suppressed == 0)
+			{
+				continue;
+			}
+
+			auto window_end = slot.window_start + RATE_LIMIT_WINDOW;
+			if (everything || now >= window_end)
+			{
+				append_suppressed(out, slot.level, slot.text, slot.length, slot.suppressed);
+				slot.suppressed = 0;
+			}
+			else if (!next_report.has_value() || window_end < next_report.value())
+			{
+				next_report = window_end;
+			}
+		}
+	}
+
+	if (!out.empty())
+	{
+		std::lock_guard guard(_direct_lock);
+		std::fwrite(out.data(), 1, out.size(), stdout);
+		std::fflush(stdout);
+	}
+
+	return next_report;
+}
+
+void Logger::wake_writer()
+{
+	// Taking the lock means the writer is either yet to check the flag, or already waiting.
+	_writer_idle.store(false);
+	{
+		std::lock_guard guard(_wake_lock);
+	}
+	_wake.notify_one();
+}
+
+void Logger::run()
+{
+	while (_running.load())
+	{
+		// Goes up before draining, so whatever wants the writer from here on either gets drained now or clears it and
+		// stops the wait below. Sequentially consistent, paired with the head store in commit_message.
+		_writer_idle.store(true);
+		auto next_report = this->drain();
+
+		std::unique_lock lock(_wake_lock);
+		auto woken = [this]() { return !_writer_idle.load() || !_running.load(); };
+		if (next_report.has_value())
+		{
+			_wake.wait_until(lock, next_report.value(), woken);
+		}
+		else
+		{
+			_wake.wait(lock, woken);
+		}
+	}
+}
+
 void log_glfw_error()
 {
 	const char* err_string;
 	glfwGetError(&err_string);
-	log("GLFW error: {}", err_string);
-}
\ No newline at end of file
+	log_error("GLFW error: {}", err_string);
+}
@@ -1,25 +1,167 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include <fmt/format.h>
 #include <vulkan/vulkan.h>
 
+enum class LogLevel {
+	Verbose,
+	Debug,
+	Info,
+	Warning,
+	Error,
+};
+
+// Anything below this level is compiled out completely. Define UGO_LOG_MIN_LEVEL to override.
+#ifndef UGO_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define UGO_LOG_MIN_LEVEL 2
+#else
+#define UGO_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+constexpr LogLevel COMPILED_LOG_LEVEL = static_cast<LogLevel>(UGO_LOG_MIN_LEVEL);
+
+// Messages are formatted on the calling thread into a per-thread ring buffer, and a background thread does the actual I/O.
+// Logging never waits on I/O: if a thread's ring is full, the message is dropped and counted instead.
 class Logger {
 public:
 	static void initialize();
+	static void shutdown();
 	static Logger& get();
 
+	Logger();
+	~Logger();
+
+	Logger& operator=(const Logger& other) = delete;
+	Logger(const Logger& other) = delete;
+
 	template <typename... T>
 	void log(fmt::format_string<T...> fmt_string, T&&... args);
+
+	template <typename... T>
+	void log(LogLevel level, fmt::format_string<T...> fmt_string, T&&... args);
+
+	bool enabled(LogLevel level) { return level >= COMPILED_LOG_LEVEL && level >= _level.load(std::memory_order_relaxed); }
+	void set_level(LogLevel level) { _level.store(level, std::memory_order_relaxed); }
+
 private:
+	static constexpr size_t MESSAGE_SIZE = 512;
+	static constexpr size_t RING_CAPACITY = 512;
+	static constexpr size_t MAX_THREADS = 64;
+
+	// Identical messages past the burst limit within one window are suppressed and counted.
+	static constexpr size_t RATE_LIMIT_SLOTS = 64;
+	static constexpr uint32_t RATE_LIMIT_BURST = 5;
+	static constexpr std::chrono::milliseconds RATE_LIMIT_WINDOW = std::chrono::milliseconds(1000);
+	// How much of a suppressed message is kept to say what was suppressed.
+	static constexpr size_t SUPPRESSED_TEXT_SIZE = 120;
+
+	struct Message {
+		LogLevel level;
+		uint32_t length;
+		char text[MESSAGE_SIZE - 8];
+	};
+
+	struct RateLimitSlot {
+		uint64_t hash;
+		std::chrono::steady_clock::time_point window_start;
+		uint32_t count;
+		uint32_t suppressed;
+
+		LogLevel level;
+		uint32_t length;
+		char text[SUPPRESSED_TEXT_SIZE];
+	};
+
+	// Single producer (the owning thread), single consumer (the writer thread).
+	struct ThreadState {
+		alignas(64) std::atomic<uint64_t> head = 0;
+		alignas(64) std::atomic<uint64_t> tail = 0;
+		std::atomic<uint64_t> dropped = 0;
+
+		std::array<Message, RING_CAPACITY> ring;
+
+		// Shared with the writer, which reports suppressed repeats once their window is over. Only contended while
+		// the writer sweeps the slots.
+		std::mutex rate_limit_lock;
+		std::array<RateLimitSlot, RATE_LIMIT_SLOTS> rate_limits = {};
+		// Slots that got reused before the writer reported their suppressed repeats.
+		std::vector<RateLimitSlot> evicted;
+	};
+
+	ThreadState* thread_state();
+
+	Message* begin_message(ThreadState* state);
+	void commit_message(ThreadState* state, Message* message, LogLevel level, size_t length);
+	void write_direct(LogLevel level, std::string_view text);
+
+	// Writes out every ring, and the suppressed repeats of windows that are over (or all of them). Returns when the next
+	// window with anything suppressed in it is over, if there is one.
+	std::optional<std::chrono::steady_clock::time_point> drain(bool everything = false);
+	void wake_writer();
+	void run();
+
+	std::atomic<LogLevel> _level = LogLevel::Verbose;
+
+	uint64_t _id;
+	std::mutex _threads_lock;
+	std::array<std::unique_ptr<ThreadState>, MAX_THREADS> _threads;
+	std::atomic<size_t> _thread_count = 0;
+
+	// Used for threads beyond MAX_THREADS, which fall back to writing synchronously.
+	std::mutex _direct_lock;
+
+	std::atomic<bool> _running = true;
+	// Set while the writer is waiting for messages, so only the first message after that has to wake it.
+	std::atomic<bool> _writer_idle = false;
+	std::mutex _wake_lock;
+	std::condition_variable _wake;
+	std::thread _writer;
+
 	static std::optional<Logger> instance;
 };
 
 template <typename... T>
 void Logger::log(fmt::format_string<T...> fmt_string, T&&... args)
 {
-	fmt::println(fmt_string, std::forward<T>(args)...);
+	this->log(LogLevel::Info, fmt_string, std::forward<T>(args)...);
+}
+
+template <typename... T>
+void Logger::log(LogLevel level, fmt::format_string<T...> fmt_string, T&&... args)
+{
+	if (!this->enabled(level))
+	{
+		return;
+	}
+
+	ThreadState* state = this->thread_state();
+	if (state == nullptr)
+	{
+		this->write_direct(level, fmt::format(fmt_string, std::forward<T>(args)...));
+		return;
+	}
+
+	Message* message = this->begin_message(state);
+	if (message == nullptr)
+	{
+		return;
+	}
+
+	auto result = fmt::format_to_n(message->text, sizeof(message->text), fmt_string, std::forward<T>(args)...);
+	this->commit_message(state, message, level, std::min(result.size, sizeof(message->text)));
 }
 
 template <typename... T>
@@ -28,4 +170,37 @@ static void log(fmt::format_string<T...> fmt_string, T&&... args)
 	Logger::get().log(fmt_string, std::forward<T>(args)...);
 }
 
-void log_glfw_error();
\ No newline at end of file
+template <LogLevel Level, typename... T>
+static void log_at(fmt::format_string<T...> fmt_string, T&&... args)
+{
+	if constexpr (Level >= COMPILED_LOG_LEVEL)
+	{
+		Logger::get().log(Level, fmt_string, std::forward<T>(args)...);
+	}
+}
+
+template <typename... T>
+static void log_verbose(fmt::format_string<T...> fmt_string, T&&... args)
+{
+	log_at<LogLevel::Verbose>(fmt_string, std::forward<T>(args)...);
+}
+
+template <typename... T>
+static void log_debug(fmt::format_string<T...> fmt_string, T&&... args)
+{
+	log_at<LogLevel::Debug>(fmt_string, std::forward<T>(args)...);
+}
+
+template <typename... T>
+static void log_warning(fmt::format_string<T...> fmt_string, T&&... args)
+{
+	log_at<LogLevel::Warning>(fmt_string, std::forward<T>(args)...);
+}
+
+template <typename... T>
+static void log_error(fmt::format_string<T...> fmt_string, T&&... args)
+{
+	log_at<LogLevel::Error>(fmt_string, std::forward<T>(args)...);
+}
+
+void log_glfw_error();
@@ -1,33 +1,103 @@
 #include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include <GLFW/glfw3.h>
 #include <fmt/core.h>
 
+#include "core/job_system.h"
 #include "window/window.h"
 #include "logger.h"
 
+vk::ContextOptions parse_options(int argc, char **argv)
+{
+    vk::ContextOptions options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+
+        if (arg == "--device" && i + 1 < argc)
+        {
+            options.device_selector = argv[++i];
+        }
+        else if (arg.starts_with("--device="))
+        {
+            options.device_selector = std::string(arg.substr(std::string_view("--device=").size()));
+        }
+        else if (arg.starts_with("--frame-priority="))
+        {
+            options.queue_priorities.frame = std::stof(std::string(arg.substr(std::string_view("--frame-priority=").size())));
+        }
+        else if (arg.starts_with("--streaming-priority="))
+        {
+            options.queue_priorities.streaming = std::stof(std::string(arg.substr(std::string_view("--streaming-priority=").size())));
+        }
+    }
+
+    return options;
+}
+
+core::JobSystemSettings parse_job_settings(int argc, char **argv)
+{
+    core::JobSystemSettings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--pin-threads")
+        {
+            settings.pin_threads = true;
+        }
+    }
+
+    return settings;
+}
+
+ThreadingMode parse_threading_mode(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--single-thread")
+        {
+            return ThreadingMode::SingleThreaded;
+        }
+    }
+
+    return ThreadingMode::RenderThread;
+}
+
 int main(int argc, char **argv)
 {
+    Logger::initialize();
+    // Before anything that might want to run jobs, and on the main thread, which becomes worker 0.
+    core::JobSystem::initialize(parse_job_settings(argc, argv));
+
     int result = glfwInit();
     if (result == GLFW_FALSE)
     {
         log_glfw_error();
+        core::JobSystem::shutdown();
+        Logger::shutdown();
         return 1;
     }
 
     try
     {
-        Logger::initialize();
-        Window window(1080, 720, "ugo-vk");
+        Window window(1080, 720, "ugo-vk", parse_options(argc, argv));
 
-        window.run();
+        window.run(parse_threading_mode(argc, argv));
     }
     catch (std::runtime_error &e)
     {
-        log("Runtime error: {}", e.what());
+        log_error("Runtime error: {}", e.what());
     }
 
     glfwTerminate();
 
+    core::JobSystem::shutdown();
+
+    // Joins the writer thread, so everything logged so far actually makes it out.
+    Logger::shutdown();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "attachment_pool.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "logger.h"
+#include "vk/device.h"
+#include "vk/vulkan_error.h"
+
+const VkImageUsageFlags ATTACHMENT_ONLY_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+std::vector<VkDeviceSize> render::place_aliased(std::span<const AliasingRequest> requests, VkDeviceSize& total_size)
+{
+	std::vector<VkDeviceSize> offsets(requests.size(), 0);
+	total_size = 0;
+
+	std::vector<size_t> order(requests.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return requests[a].size > requests[b].size; });
+
+	std::vector<size_t> placed;
+	std::vector<size_t> live;
+
+	for (size_t idx : order)
+	{
+		const AliasingRequest& request = requests[idx];
+
+		// Everything already placed that's alive at the same time as this one, in memory order.
+		live.clear();
+		for (size_t other : placed)
+		{
+			if (requests[other].first_pass <= request.last_pass && request.first_pass <= requests[other].last_pass)
+			{
+				live.push_back(other);
+			}
+		}
+		std::sort(live.begin(), live.end(), [&](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+
+		VkDeviceSize offset = 0;
+		for (size_t other : live)
+		{
+			if (offset + request.size <= offsets[other])
+			{
+				break;
+			}
+
+			offset = std::max(offset, align_up(offsets[other] + requests[other].size, request.alignment));
+		}
+
+		offsets[idx] = offset;
+		total_size = std::max(total_size, offset + request.size);
+		placed.push_back(idx);
+	}
+
+	return offsets;
+}
+
+render::AttachmentPool::AttachmentPool(vk::Device& device) : _device(device)
+{
+}
+
+render::AttachmentPool::~AttachmentPool()
+{
+	this->reset();
+}
+
+render::AttachmentId render::AttachmentPool::add(VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t first_pass, uint32_t last_pass)
+{
+	if (_built)
+	{
+		throw std::runtime_error("Can't add attachments to a pool that's already been built.");
+	}
+
+	if ((usage & ~ATTACHMENT_ONLY_USAGE) == 0)
+	{
+		usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+
+	_attachments.push_back({ vk::Image(_device, format, extent, usage, 1, aspect, vk::ImageMemory::Unbound), first_pass, last_pass });
+
+	return static_cast<AttachmentId>(_attachments.size() - 1);
+}
+
+void render::AttachmentPool::build()
+{
+	std::vector<AliasingRequest> requests;
+	requests.reserve(_attachments.size());
+
+	uint32_t memory_type_bits = ~0u;
+	_requested_size = 0;
+
+	for (auto& attachment : _attachments)
+	{
+		VkMemoryRequirements requirements = attachment.image.memory_requirements();
+		requests.push_back({ requirements.size, requirements.alignment, attachment.first_pass, attachment.last_pass });
+
+		memory_type_bits &= requirements.memoryTypeBits;
+		_requested_size += requirements.size;
+	}
+
+	_built = true;
+	if (_attachments.empty())
+	{
+		return;
+	}
+
+	if (memory_type_bits == 0)
+	{
+		throw std::runtime_error("Attachments in the pool have no memory type in common.");
+	}
+
+	std::vector<VkDeviceSize> offsets = place_aliased(requests, _allocated_size);
+
+	VkMemoryRequirements requirements = {};
+	requirements.size = _allocated_size;
+	requirements.memoryTypeBits = memory_type_bits;
+	for (auto& request : requests)
+	{
+		requirements.alignment = std::max(requirements.alignment, request.alignment);
+	}
+
+	// Lazily allocated types only show up in memoryTypeBits when every attachment is transient.
+	VmaAllocationCreateInfo alloc_info = {};
+	alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if (_device.physical_device().has_lazily_allocated_memory())
+	{
+		alloc_info.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	auto result = vmaAllocateMemory(_device.allocator().allocator(), &requirements, &alloc_info, &_allocation, nullptr);
+	vk_check(result);
+
+	for (size_t i = 0; i < _attachments.size(); i++)
+	{
+		_attachments[i].image.bind_memory(_allocation, offsets[i]);
+	}
+
+	log_debug("Attachment pool: {} KiB for {} KiB of attachments", _allocated_size / 1024, _requested_size / 1024);
+}
+
+void render::AttachmentPool::reset()
+{
+	// The GPU may still be using them, so they go through the deletion queue. Images first, they're bound to the
+	// allocation, and the queue destroys things in the order they were retired.
+	vk::DeletionQueue& deletion_queue = _device.deletion_queue();
+	for (Attachment& attachment : _attachments)
+	{
+		deletion_queue.retire(std::move(attachment.image));
+	}
+	_attachments.clear();
+
+	if (_allocation != VK_NULL_HANDLE)
+	{
+		vk::Device& device = _device;
+		VmaAllocation allocation = _allocation;
+		deletion_queue.retire([&device, allocation]() { vmaFreeMemory(device.allocator().allocator(), allocation); });
+		_allocation = VK_NULL_HANDLE;
+	}
+
+	_built = false;
+	_allocated_size = 0;
+	_requested_size = 0;
+}
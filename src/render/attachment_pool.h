@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vk/image.h"
+
+namespace vk {
+	class Device;
+}
+
+namespace render {
+
+	struct AliasingRequest {
+		VkDeviceSize size;
+		VkDeviceSize alignment;
+		// Inclusive range of passes the resource is used in.
+		uint32_t first_pass;
+		uint32_t last_pass;
+	};
+
+	// Offsets for each request inside one block of memory, such that requests with overlapping pass ranges never
+	// overlap in memory. Biggest first, each at the lowest offset that doesn't collide with a live neighbour.
+	std::vector<VkDeviceSize> place_aliased(std::span<const AliasingRequest> requests, VkDeviceSize& total_size);
+
+	using AttachmentId = uint32_t;
+
+	// Render pass attachments packed into a single allocation. Attachments that are never alive in the same pass
+	// share memory, so adding passes doesn't keep adding VRAM.
+	// Since memory may be shared, contents don't survive past an attachment's last pass, and its first use each frame
+	// has to transition it from UNDEFINED, after whatever aliased it before.
+	class AttachmentPool {
+	public:
+		AttachmentPool(vk::Device& device);
+		~AttachmentPool();
+
+		AttachmentPool& operator=(const AttachmentPool& other) = delete;
+		AttachmentPool(const AttachmentPool& other) = delete;
+
+		// Attachments that are used as nothing but attachments are created transient.
+		AttachmentId add(VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t first_pass, uint32_t last_pass);
+
+		// Places and allocates everything added so far. Nothing can be added afterwards.
+		void build();
+
+		// Throws everything away, e.g. to rebuild at a new extent. Doesn't have to wait for the GPU, the old attachments
+		// are destroyed once it's done with them.
+		void reset();
+
+		vk::Image& get(AttachmentId id) { return _attachments.at(id).image; }
+
+		// Memory actually allocated vs. what the attachments would take up on their own.
+		VkDeviceSize allocated_size() { return _allocated_size; }
+		VkDeviceSize requested_size() { return _requested_size; }
+
+	private:
+		struct Attachment {
+			vk::Image image;
+			uint32_t first_pass;
+			uint32_t last_pass;
+		};
+
+		vk::Device& _device;
+		std::vector<Attachment> _attachments;
+		bool _built = false;
+
+		VmaAllocation _allocation = VK_NULL_HANDLE;
+		VkDeviceSize _allocated_size = 0;
+		VkDeviceSize _requested_size = 0;
+	};
+
+}
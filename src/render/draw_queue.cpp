@@ -0,0 +1,258 @@
+#include "draw_queue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "core/radix_sort.h"
+#include "render/gpu_scene.h"
+#include "vk/command_buffer.h"
+#include "vk/device.h"
+#include "vk/frame_allocator.h"
+
+const uint32_t DRAW_KEY_PASS_SHIFT = 64 - render::DRAW_KEY_PASS_BITS;
+const uint32_t DRAW_KEY_PIPELINE_SHIFT = DRAW_KEY_PASS_SHIFT - render::DRAW_KEY_PIPELINE_BITS;
+const uint32_t DRAW_KEY_MATERIAL_SHIFT = DRAW_KEY_PIPELINE_SHIFT - render::DRAW_KEY_MATERIAL_BITS;
+
+// Every draw call could bind a pipeline, the bindless set, its material and its geometry.
+const uint32_t BINDS_PER_DRAW = 4;
+
+uint64_t render::make_draw_key(uint32_t pass, PipelineId pipeline, MaterialId material, DrawMeshId mesh, float depth, bool back_to_front)
+{
+	// Behind the camera and NaN both sort first. Keeps the exponent and 7 bits of mantissa, under 1% apart.
+	uint32_t depth_bits = depth > 0.0f ? std::bit_cast<uint32_t>(depth) >> (32 - DRAW_KEY_DEPTH_BITS) : 0;
+
+	uint64_t low;
+	if (back_to_front)
+	{
+		depth_bits = ~depth_bits & ((1u << DRAW_KEY_DEPTH_BITS) - 1);
+		low = (static_cast<uint64_t>(depth_bits) << DRAW_KEY_MESH_BITS) | mesh;
+	}
+	else
+	{
+		low = (static_cast<uint64_t>(mesh) << DRAW_KEY_DEPTH_BITS) | depth_bits;
+	}
+
+	return (static_cast<uint64_t>(pass) << DRAW_KEY_PASS_SHIFT)
+		| (static_cast<uint64_t>(pipeline) << DRAW_KEY_PIPELINE_SHIFT)
+		| (static_cast<uint64_t>(material) << DRAW_KEY_MATERIAL_SHIFT)
+		| low;
+}
+
+render::DrawStats& render::DrawStats::operator+=(const DrawStats& other)
+{
+	instances += other.instances;
+	draws += other.draws;
+	pipeline_binds += other.pipeline_binds;
+	descriptor_binds += other.descriptor_binds;
+	material_binds += other.material_binds;
+	geometry_binds += other.geometry_binds;
+	binds_skipped += other.binds_skipped;
+
+	return *this;
+}
+
+render::DrawQueue::DrawQueue(vk::Device& device) : _device(device)
+{
+}
+
+render::PipelineId render::DrawQueue::add_pipeline(const vk::Pipeline& pipeline)
+{
+	if (_pipelines.size() >= (1 << DRAW_KEY_PIPELINE_BITS))
+	{
+		throw std::runtime_error(fmt::format("Draw queue is out of pipeline ids ({}).", _pipelines.size()));
+	}
+	if (pipeline.push_constant_size != sizeof(DrawQueueConstants))
+	{
+		throw std::runtime_error("Draw queue pipelines have to push DrawQueueConstants.");
+	}
+
+	_pipelines.push_back(pipeline);
+	return static_cast<PipelineId>(_pipelines.size() - 1);
+}
+
+render::GeometryId render::DrawQueue::add_geometry(GeometryPool& geometry)
+{
+	_geometry.push_back(&geometry);
+	return static_cast<GeometryId>(_geometry.size() - 1);
+}
+
+render::DrawMeshId render::DrawQueue::add_mesh(GeometryId geometry, const MeshRange& range, const MeshBounds& packing)
+{
+	if (_meshes.size() >= (1 << DRAW_KEY_MESH_BITS))
+	{
+		throw std::runtime_error(fmt::format("Draw queue is out of mesh ids ({}).", _meshes.size()));
+	}
+
+	_meshes.push_back({ geometry, range, unpack_transform(packing) });
+	return static_cast<DrawMeshId>(_meshes.size() - 1);
+}
+
+void render::DrawQueue::set_back_to_front(uint32_t pass, bool back_to_front)
+{
+	if (pass >= MAX_DRAW_PASSES)
+	{
+		throw std::runtime_error(fmt::format("Draw pass {} doesn't fit in a sort key.", pass));
+	}
+
+	_back_to_front[pass] = back_to_front;
+	_sorted = false;
+}
+
+void render::DrawQueue::submit(const DrawPacket& packet)
+{
+	if (packet.pass >= MAX_DRAW_PASSES)
+	{
+		throw std::runtime_error(fmt::format("Draw pass {} doesn't fit in a sort key.", packet.pass));
+	}
+
+	_packets.push_back(packet);
+	_sorted = false;
+}
+
+void render::DrawQueue::sort()
+{
+	if (_sorted)
+	{
+		return;
+	}
+
+	_keys.resize(_packets.size());
+	_order.resize(_packets.size());
+	for (size_t i = 0; i < _packets.size(); i++)
+	{
+		const DrawPacket& packet = _packets[i];
+		_keys[i] = make_draw_key(packet.pass, packet.pipeline, packet.material, packet.mesh, packet.depth, _back_to_front[packet.pass]);
+		_order[i] = static_cast<uint32_t>(i);
+	}
+
+	core::radix_sort(_keys, _order, _key_scratch, _order_scratch);
+	_sorted = true;
+}
+
+render::DrawStats render::DrawQueue::record(vk::CommandBuffer& cmd, vk::FrameAllocator& frame, uint32_t pass, const glm::mat4& view_proj)
+{
+	DrawStats stats;
+	if (pass >= MAX_DRAW_PASSES)
+	{
+		return stats;
+	}
+
+	this->sort();
+
+	// Pass is the top of the key, so a pass's draws are one run.
+	auto first = std::lower_bound(_keys.begin(), _keys.end(), static_cast<uint64_t>(pass) << DRAW_KEY_PASS_SHIFT);
+	auto last = _keys.end();
+	if (pass + 1 < MAX_DRAW_PASSES)
+	{
+		last = std::lower_bound(first, _keys.end(), static_cast<uint64_t>(pass + 1) << DRAW_KEY_PASS_SHIFT);
+	}
+
+	size_t begin = first - _keys.begin();
+	size_t count = last - first;
+	if (count == 0)
+	{
+		return stats;
+	}
+
+	// Draws read their transform at gl_InstanceIndex, which is their position in the pass. Sorted order puts each
+	// instanced draw's instances next to each other.
+	vk::FrameAllocator::Allocation allocation = frame.allocate(count * sizeof(GpuInstance));
+	GpuInstance* instances = static_cast<GpuInstance*>(allocation.data);
+	for (size_t i = 0; i < count; i++)
+	{
+		const DrawPacket& packet = _packets[_order[begin + i]];
+
+		GpuInstance instance = {};
+		instance.transform = packet.transform * _meshes[packet.mesh].unpack;
+		instances[i] = instance;
+	}
+
+	DrawQueueConstants constants = {};
+	constants.view_proj = view_proj;
+	constants.instances = allocation.address;
+
+	// Nothing is assumed about what was bound before.
+	const vk::Pipeline* bound_pipeline = nullptr;
+	VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+	uint32_t bound_material = UINT32_MAX;
+	uint32_t bound_geometry = UINT32_MAX;
+
+	size_t next = 0;
+	while (next < count)
+	{
+		size_t first_instance = next;
+		const DrawPacket& packet = _packets[_order[begin + first_instance]];
+		const vk::Pipeline& pipeline = _pipelines[packet.pipeline];
+		const DrawMesh& mesh = _meshes[packet.mesh];
+
+		// Everything up to the next draw that needs different state goes into one instanced draw.
+		next++;
+		while (next < count)
+		{
+			const DrawPacket& other = _packets[_order[begin + next]];
+			if (other.pipeline != packet.pipeline || other.material != packet.material || other.mesh != packet.mesh)
+			{
+				break;
+			}
+			next++;
+		}
+		uint32_t instance_count = static_cast<uint32_t>(next - first_instance);
+
+		if (&pipeline != bound_pipeline)
+		{
+			cmd.bind_pipeline(pipeline);
+			bound_pipeline = &pipeline;
+			stats.pipeline_binds++;
+
+			// Descriptor sets and push constants stay bound across pipelines with the same layout.
+			if (pipeline.layout != bound_layout)
+			{
+				_device.bindless().bind(cmd, pipeline.bind_point);
+				stats.descriptor_binds++;
+
+				constants.material = packet.material;
+				cmd.push(pipeline, constants);
+				bound_material = packet.material;
+				stats.material_binds++;
+
+				bound_layout = pipeline.layout;
+			}
+		}
+
+		if (packet.material != bound_material)
+		{
+			uint32_t material = packet.material;
+			cmd.push_constants(pipeline.layout, VK_SHADER_STAGE_ALL, offsetof(DrawQueueConstants, material), sizeof(material), &material);
+			bound_material = packet.material;
+			stats.material_binds++;
+		}
+
+		if (mesh.geometry != bound_geometry)
+		{
+			_geometry[mesh.geometry]->bind(cmd);
+			bound_geometry = mesh.geometry;
+			stats.geometry_binds++;
+		}
+
+		cmd.draw_indexed(mesh.range.index_count, instance_count, mesh.range.first_index, mesh.range.vertex_offset, static_cast<uint32_t>(first_instance));
+		stats.draws++;
+		stats.instances += instance_count;
+	}
+
+	uint32_t binds = stats.pipeline_binds + stats.descriptor_binds + stats.material_binds + stats.geometry_binds;
+	stats.binds_skipped = stats.draws * BINDS_PER_DRAW - binds;
+
+	return stats;
+}
+
+void render::DrawQueue::clear()
+{
+	_packets.clear();
+	_keys.clear();
+	_order.clear();
+	_sorted = true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "render/geometry_pool.h"
+#include "render/mesh_packing.h"
+#include "vk/pipeline_builder.h"
+
+namespace vk {
+	class Device;
+	class CommandBuffer;
+	class FrameAllocator;
+}
+
+namespace render {
+
+	using PipelineId = uint16_t;
+	using MaterialId = uint16_t;
+	using GeometryId = uint16_t;
+	using DrawMeshId = uint16_t;
+
+	// Sort key layout, most significant first. Sorting the keys groups draws by pass, then by pipeline, then by
+	// material, then by mesh, and orders each group by depth, so state only changes where the key's upper bits do
+	// and every draw of the same thing ends up next to each other to be instanced.
+	// Back to front passes swap mesh and depth, so only draws that are already next to each other get merged.
+	const uint32_t DRAW_KEY_PASS_BITS = 4;
+	const uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+	const uint32_t DRAW_KEY_MATERIAL_BITS = 16;
+	const uint32_t DRAW_KEY_MESH_BITS = 16;
+	const uint32_t DRAW_KEY_DEPTH_BITS = 16;
+
+	const uint32_t MAX_DRAW_PASSES = 1 << DRAW_KEY_PASS_BITS;
+
+	// Non negative floats sort the same as their bits, so depth goes in as the top of its bits. Back to front flips it.
+	uint64_t make_draw_key(uint32_t pass, PipelineId pipeline, MaterialId material, DrawMeshId mesh, float depth, bool back_to_front = false);
+
+	struct DrawPacket {
+		uint32_t pass;
+		PipelineId pipeline;
+		MaterialId material;
+		DrawMeshId mesh;
+		glm::mat4 transform;
+		// Distance from the camera.
+		float depth;
+	};
+
+	// What recording a pass cost. Skipped binds are the ones binding everything for every draw call would
+	// have done on top.
+	struct DrawStats {
+		// Submitted draws, and the instanced draw calls they were merged into.
+		uint32_t instances = 0;
+		uint32_t draws = 0;
+		uint32_t pipeline_binds = 0;
+		uint32_t descriptor_binds = 0;
+		uint32_t material_binds = 0;
+		uint32_t geometry_binds = 0;
+		uint32_t binds_skipped = 0;
+
+		DrawStats& operator+=(const DrawStats& other);
+	};
+
+	// Matches the push constant block in queue drawn shaders, see prop.frag. Pipelines added to a DrawQueue have to
+	// declare this with set_push_constants. Shaders that don't care about the material can declare everything before it.
+	struct DrawQueueConstants {
+		glm::mat4 view_proj;
+		VkDeviceAddress instances;
+		uint32_t material;
+		uint32_t pad;
+	};
+
+	// Draws that are recorded on the CPU, for whatever isn't worth putting through GpuScene.
+	// Draws are submitted in any order, then each pass is recorded sorted by its key, only binding a pipeline,
+	// the bindless set, a material or a geometry pool when it differs from the previous draw's. Runs of draws with the
+	// same pipeline, material and mesh become one instanced draw.
+	// Per draw data is gathered into a GpuInstance array in frame memory in sorted order, so each instanced draw's
+	// instances are contiguous, and shaders written against scene.glsl work with either path.
+	class DrawQueue {
+	public:
+		DrawQueue(vk::Device& device);
+
+		DrawQueue& operator=(const DrawQueue& other) = delete;
+		DrawQueue(const DrawQueue& other) = delete;
+
+		// The pipeline and pool have to outlive the queue. Pipelines need the bindless layout.
+		PipelineId add_pipeline(const vk::Pipeline& pipeline);
+		GeometryId add_geometry(GeometryPool& geometry);
+		// packing is the box the mesh's positions were packed into, see render::pack_mesh. Packets are given world
+		// transforms, and the unpacking is folded in when they're recorded.
+		DrawMeshId add_mesh(GeometryId geometry, const MeshRange& range, const MeshBounds& packing);
+
+		// Transparent passes want the far draws first.
+		void set_back_to_front(uint32_t pass, bool back_to_front);
+
+		void submit(const DrawPacket& packet);
+		// Has to be called inside the pass's rendering, with the viewport set. Doesn't assume anything is bound.
+		DrawStats record(vk::CommandBuffer& cmd, vk::FrameAllocator& frame, uint32_t pass, const glm::mat4& view_proj);
+		// Drops every submitted draw. Call once all passes are recorded.
+		void clear();
+
+		uint32_t size() { return static_cast<uint32_t>(_packets.size()); }
+
+	private:
+		void sort();
+
+		vk::Device& _device;
+
+		std::vector<vk::Pipeline> _pipelines;
+		std::vector<GeometryPool*> _geometry;
+
+		struct DrawMesh {
+			GeometryId geometry;
+			MeshRange range;
+			glm::mat4 unpack;
+		};
+		std::vector<DrawMesh> _meshes;
+		bool _back_to_front[MAX_DRAW_PASSES] = {};
+
+		std::vector<DrawPacket> _packets;
+		std::vector<uint64_t> _keys;
+		// Packet index for each key.
+		std::vector<uint32_t> _order;
+		std::vector<uint64_t> _key_scratch;
+		std::vector<uint32_t> _order_scratch;
+		bool _sorted = true;
+	};
+
+}
@@ -0,0 +1,55 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+
+render::DynamicResolution::DynamicResolution(DynamicResolutionSettings settings) : _settings(settings), _scale(settings.max_scale)
+{
+}
+
+float render::DynamicResolution::update(double gpu_ms)
+{
+	if (!_has_sample)
+	{
+		_smoothed_ms = gpu_ms;
+		_has_sample = true;
+	}
+	else
+	{
+		_smoothed_ms += (gpu_ms - _smoothed_ms) * _settings.smoothing;
+	}
+
+	_frames_since_change++;
+	if (_frames_since_change < _settings.settle_frames || _smoothed_ms <= 0.0)
+	{
+		return _scale;
+	}
+
+	bool over_target = _smoothed_ms > _settings.target_ms;
+	bool under_target = _smoothed_ms < _settings.target_ms * (1.0 - _settings.headroom);
+
+	_frames_under_target = under_target ? _frames_under_target + 1 : 0;
+
+	if (!over_target && _frames_under_target < _settings.settle_frames)
+	{
+		return _scale;
+	}
+
+	// GPU time goes roughly with pixel count, which is the scale squared.
+	float ideal = _scale * static_cast<float>(std::sqrt(_settings.target_ms / _smoothed_ms));
+	float next = std::clamp(ideal, _scale - _settings.max_step, _scale + _settings.max_step);
+	next = std::clamp(next, _settings.min_scale, _settings.max_scale);
+
+	if (next != _scale)
+	{
+		log_debug("Render scale {:.2f} -> {:.2f} ({:.2f} ms on the GPU)", _scale, next, _smoothed_ms);
+
+		_scale = next;
+		_frames_since_change = 0;
+		_frames_under_target = 0;
+	}
+
+	return _scale;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace render {
+
+	struct DynamicResolutionSettings {
+		// GPU time to aim for. Leave some room under the actual frame budget.
+		double target_ms = 14.0;
+
+		// Bounds on the per-axis render scale.
+		float min_scale = 0.5f;
+		float max_scale = 1.0f;
+
+		// Biggest change to the scale in one go.
+		float max_step = 0.1f;
+
+		// Only scale back up once frames come in this far under target, so we don't flip-flop around it.
+		double headroom = 0.15;
+
+		// Frames to wait after a change before judging the new resolution, and how long we have to stay under
+		// target (minus headroom) before going back up.
+		uint32_t settle_frames = 30;
+
+		// Weight of the newest sample in the smoothed frame time.
+		double smoothing = 0.1;
+	};
+
+	// Picks the internal render resolution from measured GPU frame times, trading resolution for a steady frame rate.
+	// Going over target drops resolution as soon as the last change has settled. Going back up has to be earned.
+	class DynamicResolution {
+	public:
+		DynamicResolution(DynamicResolutionSettings settings = {});
+
+		// Feed in the latest GPU frame time. Returns the scale to render the next frame at.
+		float update(double gpu_ms);
+
+		float scale() { return _scale; }
+		double smoothed_ms() { return _smoothed_ms; }
+
+	private:
+		DynamicResolutionSettings _settings;
+
+		float _scale;
+		double _smoothed_ms = 0.0;
+		bool _has_sample = false;
+
+		uint32_t _frames_since_change = 0;
+		uint32_t _frames_under_target = 0;
+	};
+
+}
@@ -0,0 +1,259 @@
+#include "frustum_cull.h"
+
+#include <bit>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define UGO_CULL_X86 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define UGO_CULL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The SIMD kernels have to compute plane distances in exactly this order (and without fused multiply-adds) to agree
+// with this bit for bit. CMakeLists.txt turns off contraction for this file, so the compiler can't fuse them here either.
+// check_instance_culling makes sure they do agree.
+bool sphere_visible(const render::SphereArrays& spheres, uint32_t i, const render::CullPlanes& planes)
+{
+	for (const float* plane : planes.planes)
+	{
+		float distance = plane[0] * spheres.x[i] + plane[1] * spheres.y[i] + plane[2] * spheres.z[i] + plane[3];
+		if (!(distance >= -spheres.radius[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t render::detail::cull_spheres_scalar(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible)
+{
+	uint32_t count = 0;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		if (sphere_visible(spheres, i, planes))
+		{
+			visible[count++] = i;
+		}
+	}
+
+	return count;
+}
+
+// Appends base + the index of every set bit in mask, lowest first.
+uint32_t write_mask(uint32_t mask, uint32_t base, uint32_t* visible)
+{
+	uint32_t count = 0;
+	while (mask != 0)
+	{
+		visible[count++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+		mask &= mask - 1;
+	}
+
+	return count;
+}
+
+#ifdef UGO_CULL_X86
+
+// 4 spheres against every plane, as a bit per sphere.
+uint32_t sse_visible_mask(const render::SphereArrays& spheres, uint32_t i, const __m128 (&plane)[6][4])
+{
+	__m128 x = _mm_loadu_ps(spheres.x + i);
+	__m128 y = _mm_loadu_ps(spheres.y + i);
+	__m128 z = _mm_loadu_ps(spheres.z + i);
+	__m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int p = 0; p < 6; p++)
+	{
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], x), _mm_mul_ps(plane[p][1], y)), _mm_mul_ps(plane[p][2], z)), plane[p][3]);
+		inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_radius));
+	}
+
+	return static_cast<uint32_t>(_mm_movemask_ps(inside));
+}
+
+uint32_t render::detail::cull_spheres_sse(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible)
+{
+	__m128 plane[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			plane[p][c] = _mm_set1_ps(planes.planes[p][c]);
+		}
+	}
+
+	uint32_t count = 0;
+	uint32_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		uint32_t mask = sse_visible_mask(spheres, i, plane) | (sse_visible_mask(spheres, i + 4, plane) << 4);
+		count += write_mask(mask, i, visible + count);
+	}
+
+	return count + cull_spheres_scalar(spheres, i, end, planes, visible + count);
+}
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	// The OS has to save the upper halves of the registers, too.
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#else
+
+uint32_t render::detail::cull_spheres_sse(const SphereArrays&, uint32_t, uint32_t, const CullPlanes&, uint32_t*)
+{
+	throw std::runtime_error("SSE culling isn't built for this CPU.");
+}
+
+uint32_t render::detail::cull_spheres_avx2(const SphereArrays&, uint32_t, uint32_t, const CullPlanes&, uint32_t*)
+{
+	throw std::runtime_error("AVX2 culling isn't built for this CPU.");
+}
+
+#endif
+
+#ifdef UGO_CULL_NEON
+
+uint32_t neon_visible_mask(const render::SphereArrays& spheres, uint32_t i, const float32x4_t (&plane)[6][4])
+{
+	float32x4_t x = vld1q_f32(spheres.x + i);
+	float32x4_t y = vld1q_f32(spheres.y + i);
+	float32x4_t z = vld1q_f32(spheres.z + i);
+	float32x4_t neg_radius = vnegq_f32(vld1q_f32(spheres.radius + i));
+
+	uint32x4_t inside = vdupq_n_u32(0xffffffff);
+	for (int p = 0; p < 6; p++)
+	{
+		// Separate multiplies and adds, vmlaq_f32 may fuse.
+		float32x4_t distance = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(plane[p][0], x), vmulq_f32(plane[p][1], y)), vmulq_f32(plane[p][2], z)), plane[p][3]);
+		inside = vandq_u32(inside, vcgeq_f32(distance, neg_radius));
+	}
+
+	const uint32_t bits[4] = { 1, 2, 4, 8 };
+	return vaddvq_u32(vandq_u32(inside, vld1q_u32(bits)));
+}
+
+uint32_t render::detail::cull_spheres_neon(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible)
+{
+	float32x4_t plane[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			plane[p][c] = vdupq_n_f32(planes.planes[p][c]);
+		}
+	}
+
+	uint32_t count = 0;
+	uint32_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		uint32_t mask = neon_visible_mask(spheres, i, plane) | (neon_visible_mask(spheres, i + 4, plane) << 4);
+		count += write_mask(mask, i, visible + count);
+	}
+
+	return count + cull_spheres_scalar(spheres, i, end, planes, visible + count);
+}
+
+#else
+
+uint32_t render::detail::cull_spheres_neon(const SphereArrays&, uint32_t, uint32_t, const CullPlanes&, uint32_t*)
+{
+	throw std::runtime_error("NEON culling isn't built for this CPU.");
+}
+
+#endif
+
+render::CullIsa render::best_cull_isa()
+{
+#if defined(UGO_CULL_X86)
+	static const bool has_avx2 = cpu_has_avx2();
+	return has_avx2 ? CullIsa::Avx2 : CullIsa::Sse;
+#elif defined(UGO_CULL_NEON)
+	return CullIsa::Neon;
+#else
+	return CullIsa::Scalar;
+#endif
+}
+
+bool render::cull_isa_supported(CullIsa isa)
+{
+	switch (isa)
+	{
+	case CullIsa::Scalar:
+		return true;
+#if defined(UGO_CULL_X86)
+	case CullIsa::Sse:
+		return true;
+	case CullIsa::Avx2:
+		return best_cull_isa() == CullIsa::Avx2;
+#elif defined(UGO_CULL_NEON)
+	case CullIsa::Neon:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* render::cull_isa_name(CullIsa isa)
+{
+	switch (isa)
+	{
+	case CullIsa::Scalar:
+		return "scalar";
+	case CullIsa::Sse:
+		return "SSE";
+	case CullIsa::Avx2:
+		return "AVX2";
+	case CullIsa::Neon:
+		return "NEON";
+	}
+
+	return "unknown";
+}
+
+uint32_t render::cull_spheres(CullIsa isa, const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible)
+{
+	switch (isa)
+	{
+	case CullIsa::Scalar:
+		return detail::cull_spheres_scalar(spheres, begin, end, planes, visible);
+	case CullIsa::Sse:
+		return detail::cull_spheres_sse(spheres, begin, end, planes, visible);
+	case CullIsa::Avx2:
+		if (!cull_isa_supported(CullIsa::Avx2))
+		{
+			throw std::runtime_error("This CPU can't run AVX2 culling.");
+		}
+		return detail::cull_spheres_avx2(spheres, begin, end, planes, visible);
+	case CullIsa::Neon:
+		return detail::cull_spheres_neon(spheres, begin, end, planes, visible);
+	}
+
+	throw std::runtime_error(fmt::format("Unknown cull ISA {}.", static_cast<int>(isa)));
+}
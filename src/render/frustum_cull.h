@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+namespace render {
+
+	// Bounding spheres as one array per component, so kernels can load 8 of each at once.
+	struct SphereArrays {
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* radius;
+	};
+
+	// Inward facing and normalized, so a point is inside a plane when dot(xyz, point) + w >= 0. See frustum_planes.
+	struct CullPlanes {
+		float planes[6][4];
+	};
+
+	// Which cull_spheres kernel to run. Every one gives the same result as Scalar, which is the reference.
+	enum class CullIsa {
+		Scalar,
+		// 2x4 wide. Part of x86-64, so always there.
+		Sse,
+		// 8 wide. Picked at runtime, the rest of the program doesn't need to be built for it.
+		Avx2,
+		// 2x4 wide. Part of AArch64.
+		Neon,
+	};
+
+	// The widest kernel this CPU can run.
+	CullIsa best_cull_isa();
+	// Whether cull_spheres can run isa here.
+	bool cull_isa_supported(CullIsa isa);
+	const char* cull_isa_name(CullIsa isa);
+
+	// Writes the indices in [begin, end) of every sphere that isn't completely outside one of the planes to visible,
+	// in order, and returns how many there were. visible needs room for end - begin indices.
+	// Throws if isa can't run here.
+	uint32_t cull_spheres(CullIsa isa, const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible);
+
+	namespace detail {
+		uint32_t cull_spheres_scalar(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible);
+		uint32_t cull_spheres_sse(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible);
+		uint32_t cull_spheres_avx2(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible);
+		uint32_t cull_spheres_neon(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible);
+	}
+
+}
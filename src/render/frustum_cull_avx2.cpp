@@ -0,0 +1,49 @@
+#include "frustum_cull.h"
+
+// Built with AVX2 enabled (see CMakeLists.txt), so nothing in here can run before best_cull_isa() says it's safe.
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+#include <bit>
+
+uint32_t render::detail::cull_spheres_avx2(const SphereArrays& spheres, uint32_t begin, uint32_t end, const CullPlanes& planes, uint32_t* visible)
+{
+	__m256 plane[6][4];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			plane[p][c] = _mm256_set1_ps(planes.planes[p][c]);
+		}
+	}
+
+	uint32_t count = 0;
+	uint32_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(spheres.x + i);
+		__m256 y = _mm256_loadu_ps(spheres.y + i);
+		__m256 z = _mm256_loadu_ps(spheres.z + i);
+		__m256 neg_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+
+		// No FMA, to match the scalar reference exactly.
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[p][0], x), _mm256_mul_ps(plane[p][1], y)), _mm256_mul_ps(plane[p][2], z)), plane[p][3]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+		}
+
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+		while (mask != 0)
+		{
+			visible[count++] = i + static_cast<uint32_t>(std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+	}
+
+	return count + cull_spheres_scalar(spheres, i, end, planes, visible + count);
+}
+
+#endif
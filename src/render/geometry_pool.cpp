@@ -0,0 +1,88 @@
+#include "geometry_pool.h"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "vk/command_buffer.h"
+#include "vk/device.h"
+#include "vk/uploader.h"
+
+VkDrawIndexedIndirectCommand render::MeshRange::draw_command(uint32_t instance_count, uint32_t first_instance) const
+{
+	VkDrawIndexedIndirectCommand command = {};
+	command.indexCount = index_count;
+	command.instanceCount = instance_count;
+	command.firstIndex = first_index;
+	command.vertexOffset = vertex_offset;
+	command.firstInstance = first_instance;
+
+	return command;
+}
+
+render::GeometryPool::GeometryPool(vk::Device& device, uint32_t vertex_stride, uint32_t max_vertices, uint32_t max_indices) :
+	_vertex_stride(vertex_stride),
+	// Storage and device address usage let shaders pull vertices and indices straight out of the pool too.
+	_vertex_buffer(
+		device,
+		static_cast<VkDeviceSize>(vertex_stride) * max_vertices,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		vk::MemoryUsage::GpuOnly),
+	_index_buffer(
+		device,
+		static_cast<VkDeviceSize>(sizeof(uint32_t)) * max_indices,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		vk::MemoryUsage::GpuOnly),
+	_vertex_ranges(max_vertices),
+	_index_ranges(max_indices)
+{
+}
+
+render::MeshRange render::GeometryPool::add_mesh(vk::Uploader& uploader, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+	auto vertex_offset = _vertex_ranges.allocate(vertex_count);
+	if (!vertex_offset.has_value())
+	{
+		throw std::runtime_error(fmt::format("Geometry pool out of vertex space ({} requested, {} free).", vertex_count, _vertex_ranges.free_space()));
+	}
+
+	auto first_index = _index_ranges.allocate(index_count);
+	if (!first_index.has_value())
+	{
+		_vertex_ranges.free(vertex_offset.value(), vertex_count);
+		throw std::runtime_error(fmt::format("Geometry pool out of index space ({} requested, {} free).", index_count, _index_ranges.free_space()));
+	}
+
+	uploader.upload(_vertex_buffer, static_cast<VkDeviceSize>(vertex_offset.value()) * _vertex_stride, vertices, static_cast<VkDeviceSize>(vertex_count) * _vertex_stride);
+	uploader.upload(_index_buffer, static_cast<VkDeviceSize>(first_index.value()) * sizeof(uint32_t), indices, static_cast<VkDeviceSize>(index_count) * sizeof(uint32_t));
+
+	MeshRange mesh = {};
+	mesh.first_index = first_index.value();
+	mesh.index_count = index_count;
+	mesh.vertex_offset = static_cast<int32_t>(vertex_offset.value());
+	mesh.vertex_count = vertex_count;
+
+	return mesh;
+}
+
+render::MeshRange render::GeometryPool::add_mesh(vk::Uploader& uploader, const PackedMesh& mesh, std::span<const uint32_t> indices)
+{
+	if (_vertex_stride != sizeof(PackedVertex))
+	{
+		throw std::runtime_error(fmt::format("Packed meshes need a pool with a {} byte vertex stride, not {}.", sizeof(PackedVertex), _vertex_stride));
+	}
+
+	return this->add_mesh(uploader, mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+void render::GeometryPool::remove_mesh(const MeshRange& mesh)
+{
+	_vertex_ranges.free(static_cast<uint32_t>(mesh.vertex_offset), mesh.vertex_count);
+	_index_ranges.free(mesh.first_index, mesh.index_count);
+}
+
+void render::GeometryPool::bind(vk::CommandBuffer& cmd)
+{
+	cmd.bind_vertex_buffer(0, _vertex_buffer);
+	cmd.bind_index_buffer(_index_buffer, VK_INDEX_TYPE_UINT32);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <span>
+
+#include "core/range_allocator.h"
+#include "render/mesh_packing.h"
+#include "vk/buffer.h"
+
+namespace vk {
+	class Device;
+	class CommandBuffer;
+	class Uploader;
+}
+
+namespace render {
+
+	// Where a mesh lives inside the geometry pool. Indices are relative to the mesh, so draws use vertex_offset.
+	struct MeshRange {
+		uint32_t first_index;
+		uint32_t index_count;
+		int32_t vertex_offset;
+		uint32_t vertex_count;
+
+		VkDrawIndexedIndirectCommand draw_command(uint32_t instance_count = 1, uint32_t first_instance = 0) const;
+	};
+
+	// A few big vertex and index buffers that every mesh is sub-allocated out of, so the whole scene is drawn
+	// with one vertex/index buffer bind. All meshes in a pool share a vertex format.
+	class GeometryPool {
+	public:
+		GeometryPool(vk::Device& device, uint32_t vertex_stride, uint32_t max_vertices, uint32_t max_indices);
+
+		GeometryPool& operator=(const GeometryPool& other) = delete;
+		GeometryPool(const GeometryPool& other) = delete;
+
+		// Queues the upload, so flush the uploader before drawing the mesh. Throws if the pool is out of space.
+		MeshRange add_mesh(vk::Uploader& uploader, const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+		// For pools of PackedVertex, see render::pack_mesh. Drawing it needs the mesh's bounds folded into its transforms.
+		MeshRange add_mesh(vk::Uploader& uploader, const PackedMesh& mesh, std::span<const uint32_t> indices);
+		void remove_mesh(const MeshRange& mesh);
+
+		// Binds the vertex buffer at binding 0 and the index buffer.
+		void bind(vk::CommandBuffer& cmd);
+
+		uint32_t vertex_stride() { return _vertex_stride; }
+		vk::Buffer& vertex_buffer() { return _vertex_buffer; }
+		vk::Buffer& index_buffer() { return _index_buffer; }
+
+	private:
+		uint32_t _vertex_stride;
+
+		vk::Buffer _vertex_buffer;
+		vk::Buffer _index_buffer;
+
+		core::RangeAllocator _vertex_ranges;
+		core::RangeAllocator _index_ranges;
+	};
+
+}
@@ -0,0 +1,223 @@
+#include "gpu_scene.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "render/hiz.h"
+#include "vk/command_buffer.h"
+#include "vk/device.h"
+#include "vk/frame_allocator.h"
+#include "vk/uploader.h"
+
+// Matches CullData in cull.comp. Too big for push constants, so it goes through frame memory.
+struct CullConstants {
+	glm::mat4 prev_view_proj;
+	glm::vec4 frustum[6];
+	glm::vec3 camera_position;
+	float lod_scale;
+	VkDeviceAddress meshes;
+	VkDeviceAddress instances;
+	VkDeviceAddress draws;
+	VkDeviceAddress count;
+	uint32_t instance_count;
+	uint32_t hiz_texture;
+	uint32_t hiz_sampler;
+	uint32_t hiz_levels;
+	float hiz_size[2];
+	uint32_t hiz_valid;
+	float projection_scale;
+};
+static_assert(sizeof(CullConstants) == 240);
+
+const uint32_t CULL_GROUP_SIZE = 64;
+
+const VkBufferUsageFlags SCENE_BUFFER_USAGE = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+render::GpuScene::GpuScene(vk::Device& device, uint32_t max_meshes, uint32_t max_instances) :
+	_device(device),
+	_max_meshes(max_meshes),
+	_max_instances(max_instances),
+	_mesh_buffer(device, sizeof(GpuMesh) * static_cast<VkDeviceSize>(max_meshes), SCENE_BUFFER_USAGE, vk::MemoryUsage::GpuOnly),
+	_instance_buffer(device, sizeof(GpuInstance) * static_cast<VkDeviceSize>(max_instances), SCENE_BUFFER_USAGE, vk::MemoryUsage::CpuToGpu),
+	_draw_buffer(device, sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(max_instances), SCENE_BUFFER_USAGE | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, vk::MemoryUsage::GpuOnly),
+	_count_buffer(device, sizeof(uint32_t), SCENE_BUFFER_USAGE | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, vk::MemoryUsage::GpuOnly)
+{
+	vk::ComputePipelineBuilder builder(device);
+	builder.set_shader_from_file("shader/cull.comp.spv");
+	builder.set_layout(device.bindless().layout());
+	builder.set_push_constants<CullConstants>();
+	_cull_pipeline = builder.build();
+}
+
+std::array<glm::vec4, 6> render::frustum_planes(const glm::mat4& view_proj)
+{
+	// glm is column major, so rows have to be put together by hand.
+	auto row = [&](int i) { return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]); };
+
+	std::array<glm::vec4, 6> planes = {
+		row(3) + row(0),
+		row(3) - row(0),
+		row(3) + row(1),
+		row(3) - row(1),
+		row(2),
+		row(3) - row(2),
+	};
+
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
+
+render::MeshId render::GpuScene::add_mesh(std::span<const MeshLod> lods, glm::vec4 bounds, const MeshBounds& packing)
+{
+	if (_meshes.size() == _max_meshes)
+	{
+		throw std::runtime_error(fmt::format("GPU scene is full ({} meshes).", _max_meshes));
+	}
+
+	if (lods.empty() || lods.size() > MAX_MESH_LODS)
+	{
+		throw std::runtime_error(fmt::format("Meshes need 1 to {} LODs, got {}.", MAX_MESH_LODS, lods.size()));
+	}
+
+	// The GPU only sees transforms with the unpacking folded in, so culling needs the sphere in packed space. The radius
+	// is scaled by the smallest axis, which stays conservative when packing isn't a cube.
+	glm::mat4 unpack = render::unpack_transform(packing);
+	glm::vec3 unpack_scale(unpack[0][0], unpack[1][1], unpack[2][2]);
+
+	GpuMesh mesh = {};
+	mesh.bounds = glm::vec4((glm::vec3(bounds) - glm::vec3(unpack[3])) / unpack_scale, bounds.w / std::min({ unpack_scale.x, unpack_scale.y, unpack_scale.z }));
+	mesh.lod_count = static_cast<uint32_t>(lods.size());
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		mesh.lods[i].first_index = lods[i].range.first_index;
+		mesh.lods[i].index_count = lods[i].range.index_count;
+		mesh.lods[i].vertex_offset = lods[i].range.vertex_offset;
+		mesh.lods[i].min_screen_size = lods[i].min_screen_size;
+	}
+	_meshes.push_back(mesh);
+	_unpack_transforms.push_back(unpack);
+
+	return static_cast<MeshId>(_meshes.size() - 1);
+}
+
+render::MeshId render::GpuScene::add_mesh(const MeshRange& range, glm::vec4 bounds, const MeshBounds& packing)
+{
+	MeshLod lod = { range, 0.0f };
+	return this->add_mesh(std::span<const MeshLod>(&lod, 1), bounds, packing);
+}
+
+render::InstanceId render::GpuScene::add_instance(MeshId mesh, const glm::mat4& transform)
+{
+	if (_instances.size() == _max_instances)
+	{
+		throw std::runtime_error(fmt::format("GPU scene is full ({} instances).", _max_instances));
+	}
+
+	if (mesh >= _meshes.size())
+	{
+		throw std::runtime_error(fmt::format("No mesh {} in the GPU scene.", mesh));
+	}
+
+	GpuInstance instance = {};
+	instance.transform = transform * _unpack_transforms[mesh];
+	instance.mesh = mesh;
+	_instances.push_back(instance);
+
+	return static_cast<InstanceId>(_instances.size() - 1);
+}
+
+void render::GpuScene::upload(vk::Uploader& uploader)
+{
+	uint32_t mesh_count = static_cast<uint32_t>(_meshes.size());
+	if (mesh_count > _uploaded_meshes)
+	{
+		uploader.upload(_mesh_buffer, sizeof(GpuMesh) * static_cast<VkDeviceSize>(_uploaded_meshes), &_meshes[_uploaded_meshes], sizeof(GpuMesh) * static_cast<VkDeviceSize>(mesh_count - _uploaded_meshes));
+		_uploaded_meshes = mesh_count;
+	}
+
+	// Instances are host visible, so they're written straight in.
+	uint32_t instance_count = static_cast<uint32_t>(_instances.size());
+	if (instance_count > _uploaded_instances)
+	{
+		_instance_buffer.write(&_instances[_uploaded_instances], sizeof(GpuInstance) * static_cast<VkDeviceSize>(instance_count - _uploaded_instances), sizeof(GpuInstance) * static_cast<VkDeviceSize>(_uploaded_instances));
+		_uploaded_instances = instance_count;
+	}
+}
+
+render::GpuInstance* render::GpuScene::mapped_instances()
+{
+	return static_cast<GpuInstance*>(_instance_buffer.mapped());
+}
+
+void render::GpuScene::flush_instances()
+{
+	_instance_buffer.flush(0, sizeof(GpuInstance) * static_cast<VkDeviceSize>(_uploaded_instances));
+}
+
+void render::GpuScene::cull(vk::CommandBuffer& cmd, vk::FrameAllocator& frame, HiZ& hiz, const CullCamera& camera, const glm::mat4& prev_view_proj)
+{
+	vk::BufferBarrierState indirect_state = {};
+	indirect_state.stage = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+	indirect_state.access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+	vk::BufferBarrierState clear_state = {};
+	clear_state.stage = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	clear_state.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	vk::BufferBarrierState cull_state = {};
+	cull_state.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	cull_state.access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	// Last frame's draw has to be done with the count and the draws before they're overwritten.
+	vk::buffer_barrier(cmd, _count_buffer, indirect_state, clear_state);
+	cmd.fill_buffer(_count_buffer, 0, sizeof(uint32_t), 0);
+	vk::buffer_barrier(cmd, _count_buffer, clear_state, cull_state);
+	vk::buffer_barrier(cmd, _draw_buffer, indirect_state, cull_state);
+
+	if (_uploaded_instances != 0)
+	{
+		std::array<glm::vec4, 6> planes = frustum_planes(camera.view_proj);
+
+		CullConstants constants = {};
+		constants.prev_view_proj = prev_view_proj;
+		std::copy(planes.begin(), planes.end(), constants.frustum);
+		constants.camera_position = camera.position;
+		constants.lod_scale = camera.lod_scale;
+		constants.meshes = _mesh_buffer.device_address();
+		constants.instances = _instance_buffer.device_address();
+		constants.draws = _draw_buffer.device_address();
+		constants.count = _count_buffer.device_address();
+		constants.instance_count = _uploaded_instances;
+		constants.hiz_texture = hiz.texture();
+		constants.hiz_sampler = hiz.sampler();
+		constants.hiz_levels = hiz.levels();
+		constants.hiz_size[0] = hiz.extent().width;
+		constants.hiz_size[1] = hiz.extent().height;
+		constants.hiz_valid = hiz.valid() ? 1 : 0;
+		constants.projection_scale = camera.projection_scale;
+
+		cmd.bind_pipeline(_cull_pipeline);
+		_device.bindless().bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+		cmd.push(_cull_pipeline, constants, frame);
+		cmd.dispatch_compute((_uploaded_instances + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	vk::buffer_barrier(cmd, _count_buffer, cull_state, indirect_state);
+	vk::buffer_barrier(cmd, _draw_buffer, cull_state, indirect_state);
+}
+
+void render::GpuScene::draw(vk::CommandBuffer& cmd)
+{
+	if (_uploaded_instances == 0)
+	{
+		return;
+	}
+
+	cmd.draw_indexed_indirect_count(_draw_buffer, 0, _count_buffer, 0, _uploaded_instances);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "render/geometry_pool.h"
+#include "render/mesh_packing.h"
+#include "vk/buffer.h"
+#include "vk/pipeline_builder.h"
+
+namespace vk {
+	class CommandBuffer;
+	class Device;
+	class FrameAllocator;
+	class Uploader;
+}
+
+namespace render {
+
+	class HiZ;
+
+	// Layouts match src/shader/include/scene.glsl.
+	const uint32_t MAX_MESH_LODS = 4;
+
+	struct GpuMeshLod {
+		uint32_t first_index;
+		uint32_t index_count;
+		int32_t vertex_offset;
+		// Used while the mesh covers at least this much of the screen, see MeshLod.
+		float min_screen_size;
+	};
+	static_assert(sizeof(GpuMeshLod) == 16);
+
+	struct GpuMesh {
+		// Bounding sphere in packed space (see render::pack_mesh), radius in w.
+		glm::vec4 bounds;
+		uint32_t lod_count;
+		uint32_t pad[3];
+		GpuMeshLod lods[MAX_MESH_LODS];
+	};
+	static_assert(sizeof(GpuMesh) == 96);
+
+	struct GpuInstance {
+		glm::mat4 transform;
+		uint32_t mesh;
+		uint32_t pad[3];
+	};
+	static_assert(sizeof(GpuInstance) == 80);
+
+	struct MeshLod {
+		MeshRange range;
+		// Roughly the bounding sphere's radius over the screen's half height. Below this the next LOD takes over.
+		// Ignored for the last one.
+		float min_screen_size;
+	};
+
+	// What the cull pass needs from the camera.
+	struct CullCamera {
+		glm::mat4 view_proj;
+		glm::vec3 position;
+		// proj[1][1], which turns a sphere's radius over its distance into a screen size.
+		float projection_scale;
+		// Multiplies screen sizes before picking LODs. Under 1 switches to coarser LODs sooner.
+		float lod_scale = 1.0f;
+	};
+
+	// Left, right, bottom, top, near, far, pointing inwards and normalized, so a point's distance to the plane is
+	// dot(plane.xyz, point) + plane.w. Expects 0 to 1 clip space depth.
+	std::array<glm::vec4, 6> frustum_planes(const glm::mat4& view_proj);
+
+	using MeshId = uint32_t;
+	using InstanceId = uint32_t;
+
+	// Meshes and instances live in GPU buffers, uploaded once when they're added. Instances are host visible so their
+	// transforms can be changed in place, e.g. by SceneGraph. Every frame a compute pass culls
+	// the instances against the frustum and last frame's Hi-Z, picks a LOD for the survivors, and writes their draws
+	// packed at the front of a draw buffer along with how many there are. The whole scene is then drawn with one
+	// indirect count call, so the CPU's cost per frame doesn't depend on how many instances there are, and whatever
+	// got culled costs no vertex or fragment work.
+	// Each draw's firstInstance is its instance index, for the vertex shader to find its transform with.
+	class GpuScene {
+	public:
+		GpuScene(vk::Device& device, uint32_t max_meshes, uint32_t max_instances);
+
+		GpuScene& operator=(const GpuScene& other) = delete;
+		GpuScene(const GpuScene& other) = delete;
+
+		// Ranges have to be in the geometry pool that's bound when drawing. Throws when full.
+		// LODs go from most to least detailed, and share the bounds. They also share packing, the box their positions were
+		// packed into (see render::pack_mesh), which gets folded into every instance's transform.
+		MeshId add_mesh(std::span<const MeshLod> lods, glm::vec4 bounds, const MeshBounds& packing);
+		MeshId add_mesh(const MeshRange& range, glm::vec4 bounds, const MeshBounds& packing);
+		InstanceId add_instance(MeshId mesh, const glm::mat4& transform);
+
+		// What add_instance folds into the instance's transform. Anything writing transforms into mapped_instances has to
+		// do the same.
+		const glm::mat4& unpack_transform(InstanceId instance) { return _unpack_transforms[_instances[instance].mesh]; }
+
+		// Queues everything added since the last call, so flush the uploader before culling.
+		void upload(vk::Uploader& uploader);
+
+		uint32_t instance_count() { return _uploaded_instances; }
+		vk::Buffer& instance_buffer() { return _instance_buffer; }
+
+		// The uploaded instances, for writing new transforms into. Only while the GPU isn't using the scene, i.e.
+		// after the frame's fence. Write only, the memory is likely to be uncached. Flush before submitting.
+		GpuInstance* mapped_instances();
+		void flush_instances();
+
+		// Records the cull pass, testing occlusion against hiz if it's valid. prev_view_proj is the camera hiz was drawn with.
+		// Has to be recorded outside of rendering, and leaves the draws ready for draw().
+		void cull(vk::CommandBuffer& cmd, vk::FrameAllocator& frame, HiZ& hiz, const CullCamera& camera, const glm::mat4& prev_view_proj);
+
+		// Draws what the last cull left. The pipeline and the geometry pool have to be bound.
+		void draw(vk::CommandBuffer& cmd);
+
+	private:
+		vk::Device& _device;
+		vk::Pipeline _cull_pipeline;
+
+		uint32_t _max_meshes;
+		uint32_t _max_instances;
+
+		std::vector<GpuMesh> _meshes;
+		std::vector<glm::mat4> _unpack_transforms;
+		std::vector<GpuInstance> _instances;
+		uint32_t _uploaded_meshes = 0;
+		uint32_t _uploaded_instances = 0;
+
+		vk::Buffer _mesh_buffer;
+		vk::Buffer _instance_buffer;
+		vk::Buffer _draw_buffer;
+		vk::Buffer _count_buffer;
+	};
+
+}
@@ -0,0 +1,118 @@
+#include "hiz.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "vk/command_buffer.h"
+#include "vk/device.h"
+#include "vk/sampler_cache.h"
+
+// Matches the push constant block in hiz.comp.
+struct HizConstants {
+	uint32_t src_texture;
+	uint32_t src_sampler;
+	uint32_t dst_image;
+	int32_t src_level;
+	float src_size[2];
+	float dst_size[2];
+};
+
+const uint32_t HIZ_GROUP_SIZE = 8;
+
+VkExtent2D hiz_extent(VkExtent2D depth_extent)
+{
+	return {
+		std::bit_floor(std::max(depth_extent.width, 1u)),
+		std::bit_floor(std::max(depth_extent.height, 1u)),
+	};
+}
+
+VkExtent2D level_extent(VkExtent2D extent, uint32_t level)
+{
+	return { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+}
+
+render::HiZ::HiZ(vk::Device& device, VkExtent2D max_depth_extent) :
+	_device(device),
+	_image(device, VK_FORMAT_R32_SFLOAT, hiz_extent(max_depth_extent), VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, vk::Image::ALL_MIPS)
+{
+	vk::ComputePipelineBuilder builder(device);
+	builder.set_shader_from_file("shader/hiz.comp.spv");
+	builder.set_layout(device.bindless().layout());
+	builder.set_push_constants<HizConstants>();
+	_pipeline = builder.build();
+
+	_texture = device.bindless().add_sampled_image(_image.view(), VK_IMAGE_LAYOUT_GENERAL);
+	// Only ever read with texelFetch, the filter doesn't matter.
+	_sampler = device.bindless().add_sampler(device.samplers().get(vk::sampler_info(device, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE)));
+
+	for (uint32_t level = 0; level < _image.mip_levels(); level++)
+	{
+		_level_images.push_back(device.bindless().add_storage_image(_image.create_view(level, 1)));
+	}
+}
+
+render::HiZ::~HiZ()
+{
+	for (vk::BindlessIndex index : _level_images)
+	{
+		_device.bindless().remove_storage_image(index);
+	}
+	_device.bindless().remove_sampled_image(_texture);
+	_device.bindless().remove_sampler(_sampler);
+}
+
+void render::HiZ::build(vk::CommandBuffer& cmd, vk::BindlessIndex depth_texture, VkExtent2D depth_extent)
+{
+	vk::ImageBarrierState read_state = {};
+	read_state.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	read_state.layout = VK_IMAGE_LAYOUT_GENERAL;
+	read_state.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+	vk::ImageBarrierState write_state = {};
+	write_state.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	write_state.layout = VK_IMAGE_LAYOUT_GENERAL;
+	write_state.access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	// Culling read the whole thing last frame.
+	vk::ImageBarrierState initial_state = read_state;
+	if (!_initialized)
+	{
+		initial_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		initial_state.access = VK_ACCESS_2_NONE;
+		_initialized = true;
+	}
+	vk::transition_image(cmd, _image.image(), _image.range(), initial_state, write_state);
+
+	cmd.bind_pipeline(_pipeline);
+	_device.bindless().bind(cmd, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	VkExtent2D src_extent = depth_extent;
+	for (uint32_t level = 0; level < _image.mip_levels(); level++)
+	{
+		VkExtent2D dst_extent = level_extent(_image.extent(), level);
+
+		HizConstants constants = {};
+		constants.src_texture = level == 0 ? depth_texture : _texture;
+		constants.src_sampler = _sampler;
+		constants.dst_image = _level_images[level];
+		constants.src_level = level == 0 ? 0 : static_cast<int32_t>(level - 1);
+		constants.src_size[0] = src_extent.width;
+		constants.src_size[1] = src_extent.height;
+		constants.dst_size[0] = dst_extent.width;
+		constants.dst_size[1] = dst_extent.height;
+		cmd.push(_pipeline, constants);
+
+		cmd.dispatch_compute((dst_extent.width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (dst_extent.height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+		// The next level reads this one.
+		VkImageSubresourceRange level_range = _image.range();
+		level_range.baseMipLevel = level;
+		level_range.levelCount = 1;
+		vk::transition_image(cmd, _image.image(), level_range, write_state, read_state);
+
+		src_extent = dst_extent;
+	}
+
+	_valid = true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "vk/bindless.h"
+#include "vk/image.h"
+#include "vk/pipeline_builder.h"
+
+namespace vk {
+	class CommandBuffer;
+	class Device;
+}
+
+namespace render {
+
+	// A mip chain over the depth buffer where every texel holds the farthest depth under it, so whether something
+	// is hidden can be answered with a couple of fetches at the right level. Built with one compute dispatch per level.
+	// Level 0 is the biggest power of two that fits in the depth buffer, and always covers the region drawn this frame.
+	// The image stays in GENERAL, sampled through texture() and written through one storage image per level.
+	class HiZ {
+	public:
+		// max_depth_extent is the biggest the depth buffer will be drawn at.
+		HiZ(vk::Device& device, VkExtent2D max_depth_extent);
+		~HiZ();
+
+		HiZ& operator=(const HiZ& other) = delete;
+		HiZ(const HiZ& other) = delete;
+
+		// Reduces the top left depth_extent of the depth buffer into the pyramid. Depth has to be readable by compute
+		// shaders through depth_texture. Leaves the pyramid ready for compute shaders to read.
+		void build(vk::CommandBuffer& cmd, vk::BindlessIndex depth_texture, VkExtent2D depth_extent);
+
+		// Until the next build, e.g. after a camera cut where last frame's depth says nothing about this one.
+		void invalidate() { _valid = false; }
+		bool valid() { return _valid; }
+
+		vk::BindlessIndex texture() { return _texture; }
+		vk::BindlessIndex sampler() { return _sampler; }
+		VkExtent2D extent() { return _image.extent(); }
+		uint32_t levels() { return _image.mip_levels(); }
+
+	private:
+		vk::Device& _device;
+		vk::Image _image;
+		vk::Pipeline _pipeline;
+
+		vk::BindlessIndex _texture;
+		vk::BindlessIndex _sampler;
+		std::vector<vk::BindlessIndex> _level_images;
+
+		// The first build has to bring the image out of UNDEFINED.
+		bool _initialized = false;
+		bool _valid = false;
+	};
+
+}
@@ -0,0 +1,159 @@
+#include "instance_store.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/parallel.h"
+
+// Big enough that a chunk is worth handing to another thread, small enough to spread a few thousand instances out.
+const uint32_t CULL_CHUNK_SIZE = 4096;
+
+render::InstanceStore::InstanceStore(CullIsa isa) : _isa(isa)
+{
+}
+
+uint32_t render::InstanceStore::add(glm::vec4 bounds, const glm::mat4& transform)
+{
+	_local_bounds.push_back(bounds);
+	_transforms.push_back(transform);
+	_x.push_back(0.0f);
+	_y.push_back(0.0f);
+	_z.push_back(0.0f);
+	_radius.push_back(0.0f);
+
+	uint32_t instance = this->size() - 1;
+	this->update_sphere(instance);
+
+	return instance;
+}
+
+void render::InstanceStore::set_transform(uint32_t instance, const glm::mat4& transform)
+{
+	_transforms[instance] = transform;
+	this->update_sphere(instance);
+}
+
+render::SphereArrays render::InstanceStore::spheres()
+{
+	return { _x.data(), _y.data(), _z.data(), _radius.data() };
+}
+
+// Same as instance_bounds in scene.glsl.
+void render::InstanceStore::update_sphere(uint32_t instance)
+{
+	const glm::mat4& transform = _transforms[instance];
+	glm::vec4 bounds = _local_bounds[instance];
+
+	glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(bounds), 1.0f));
+	float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+	_x[instance] = center.x;
+	_y[instance] = center.y;
+	_z[instance] = center.z;
+	_radius[instance] = bounds.w * scale;
+}
+
+void render::InstanceStore::cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible)
+{
+	this->cull(planes, visible, _isa);
+}
+
+void render::InstanceStore::cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible, CullIsa isa)
+{
+	CullPlanes cull_planes = {};
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			cull_planes.planes[p][c] = planes[p][c];
+		}
+	}
+
+	uint32_t count = this->size();
+	uint32_t chunks = (count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+	SphereArrays spheres = this->spheres();
+
+	// Each chunk writes its survivors at its own offset first, so threads never share any of the output.
+	visible.resize(count);
+	_chunk_counts.assign(chunks, 0);
+	core::parallel_for(chunks, 1, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t chunk = first; chunk < last; chunk++)
+		{
+			uint32_t begin = chunk * CULL_CHUNK_SIZE;
+			uint32_t end = std::min(begin + CULL_CHUNK_SIZE, count);
+			_chunk_counts[chunk] = cull_spheres(isa, spheres, begin, end, cull_planes, visible.data() + begin);
+		}
+	});
+
+	// Then they get packed down. A chunk never starts before where the last one's survivors ended, so a forward copy is safe.
+	uint32_t total = 0;
+	for (uint32_t chunk = 0; chunk < chunks; chunk++)
+	{
+		auto first = visible.begin() + chunk * CULL_CHUNK_SIZE;
+		std::copy(first, first + _chunk_counts[chunk], visible.begin() + total);
+		total += _chunk_counts[chunk];
+	}
+	visible.resize(total);
+}
+
+void render::check_instance_culling()
+{
+	// More than one chunk, so it goes wide, and a tail that isn't a multiple of any kernel's width.
+	const uint32_t COUNT = CULL_CHUNK_SIZE * 3 + 5;
+
+	// A tilted box, so no plane lines up with an axis and every term of the distances matters.
+	const glm::vec3 axes[] = {
+		glm::normalize(glm::vec3(1.0f, 0.3f, -0.2f)),
+		glm::normalize(glm::vec3(-0.25f, 1.0f, 0.4f)),
+		glm::normalize(glm::vec3(0.1f, -0.35f, 1.0f)),
+	};
+	std::array<glm::vec4, 6> planes;
+	for (int a = 0; a < 3; a++)
+	{
+		planes[a * 2] = glm::vec4(axes[a], 40.0f);
+		planes[a * 2 + 1] = glm::vec4(-axes[a], 40.0f);
+	}
+
+	// Spread over about twice the box, so plenty are inside, outside and straddling a plane. Always the same spheres.
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>(seed >> 8) / 16777216.0f;
+	};
+
+	InstanceStore store(CullIsa::Scalar);
+	for (uint32_t i = 0; i < COUNT; i++)
+	{
+		glm::vec3 position(random() * 160.0f - 80.0f, random() * 160.0f - 80.0f, random() * 160.0f - 80.0f);
+		store.add(glm::vec4(0.0f, 0.0f, 0.0f, random() * 8.0f), glm::translate(glm::mat4(1.0f), position));
+	}
+
+	std::vector<uint32_t> expected;
+	store.cull(planes, expected, CullIsa::Scalar);
+	if (expected.empty() || expected.size() == COUNT)
+	{
+		throw std::runtime_error(fmt::format("Culling check is broken: {} of {} spheres visible.", expected.size(), COUNT));
+	}
+
+	std::vector<uint32_t> visible;
+	for (CullIsa isa : { CullIsa::Sse, CullIsa::Avx2, CullIsa::Neon })
+	{
+		if (!cull_isa_supported(isa))
+		{
+			continue;
+		}
+
+		store.cull(planes, visible, isa);
+		if (visible != expected)
+		{
+			auto mismatch = std::mismatch(visible.begin(), visible.end(), expected.begin(), expected.end());
+			throw std::runtime_error(fmt::format("{} culling disagrees with scalar: {} spheres visible instead of {}, first difference at {}.",
+				cull_isa_name(isa), visible.size(), expected.size(), mismatch.first - visible.begin()));
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "render/frustum_cull.h"
+
+namespace render {
+
+	// Instances for when culling has to happen on the CPU, e.g. to decide what gets recorded at all.
+	// Everything is kept in parallel arrays. World space bounding spheres get one array per component, so the cull
+	// kernels can take 8 at a time, and transforms and mesh space bounds sit alongside for updating them.
+	class InstanceStore {
+	public:
+		InstanceStore(CullIsa isa = best_cull_isa());
+
+		// bounds is the mesh space bounding sphere, radius in w.
+		uint32_t add(glm::vec4 bounds, const glm::mat4& transform);
+		void set_transform(uint32_t instance, const glm::mat4& transform);
+
+		const glm::mat4& transform(uint32_t instance) { return _transforms[instance]; }
+		uint32_t size() { return static_cast<uint32_t>(_transforms.size()); }
+		SphereArrays spheres();
+
+		CullIsa isa() { return _isa; }
+
+		// Fills visible with every instance that's at least partly inside the planes (see frustum_planes), in order.
+		// The store is culled in chunks spread over every core, which are then packed together.
+		void cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible);
+		// Same with a particular kernel, e.g. CullIsa::Scalar to check the others against.
+		void cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& visible, CullIsa isa);
+
+	private:
+		void update_sphere(uint32_t instance);
+
+		CullIsa _isa;
+
+		std::vector<float> _x;
+		std::vector<float> _y;
+		std::vector<float> _z;
+		std::vector<float> _radius;
+
+		std::vector<glm::vec4> _local_bounds;
+		std::vector<glm::mat4> _transforms;
+
+		std::vector<uint32_t> _chunk_counts;
+	};
+
+	// Culls a few chunks' worth of spheres with every kernel this CPU can run, through the same parallel path as
+	// InstanceStore::cull, and throws if any of them disagree with CullIsa::Scalar. Cheap, so it can run at startup.
+	void check_instance_culling();
+
+}
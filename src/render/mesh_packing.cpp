@@ -0,0 +1,305 @@
+#include "mesh_packing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+// These come from CMakeLists.txt, which also feeds them into packed_vertex.glsl.
+#ifndef UGO_PACKED_VERTEX_POSITION_LOCATION
+#define UGO_PACKED_VERTEX_POSITION_LOCATION 0
+#endif
+#ifndef UGO_PACKED_VERTEX_NORMAL_LOCATION
+#define UGO_PACKED_VERTEX_NORMAL_LOCATION 1
+#endif
+#ifndef UGO_PACKED_VERTEX_TANGENT_LOCATION
+#define UGO_PACKED_VERTEX_TANGENT_LOCATION 2
+#endif
+#ifndef UGO_PACKED_VERTEX_UV_LOCATION
+#define UGO_PACKED_VERTEX_UV_LOCATION 3
+#endif
+
+float sign_not_zero(float v)
+{
+	return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+int16_t to_snorm16(float v)
+{
+	return static_cast<int16_t>(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t to_unorm16(float v)
+{
+	return static_cast<uint16_t>(std::round(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+}
+
+void render::encode_octahedral(const float v[3], int16_t out[2])
+{
+	float l1 = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+	if (l1 == 0.0f)
+	{
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+
+	float x = v[0] / l1;
+	float y = v[1] / l1;
+
+	// Fold the lower hemisphere over the diagonals.
+	if (v[2] < 0.0f)
+	{
+		float folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+		float folded_y = (1.0f - std::abs(x)) * sign_not_zero(y);
+		x = folded_x;
+		y = folded_y;
+	}
+
+	out[0] = to_snorm16(x);
+	out[1] = to_snorm16(y);
+}
+
+void render::decode_octahedral(const int16_t e[2], float out[3])
+{
+	float x = std::max(e[0] / 32767.0f, -1.0f);
+	float y = std::max(e[1] / 32767.0f, -1.0f);
+	float z = 1.0f - std::abs(x) - std::abs(y);
+
+	// Unfold the lower hemisphere.
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float len = std::sqrt(x * x + y * y + z * z);
+	out[0] = x / len;
+	out[1] = y / len;
+	out[2] = z / len;
+}
+
+uint16_t render::float_to_half(float f)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(f);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// NaN and infinity.
+	if (((bits >> 23) & 0xff) == 0xff)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	// Too big, clamp to infinity.
+	if (exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+
+	// Subnormal or zero.
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half_mantissa = mantissa >> shift;
+
+		// Round to nearest even.
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half_mantissa & 1) != 0))
+		{
+			half_mantissa++;
+		}
+
+		return static_cast<uint16_t>(sign | half_mantissa);
+	}
+
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+
+	// Round to nearest even. Carrying into the exponent is fine, it rounds up to the next power of two (or infinity).
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+	{
+		half++;
+	}
+
+	return static_cast<uint16_t>(half);
+}
+
+float render::half_to_float(uint16_t h)
+{
+	uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+
+	if (exponent == 0)
+	{
+		// Subnormals are mantissa * 2^-24.
+		float value = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign != 0 ? -value : value;
+	}
+
+	if (exponent == 31)
+	{
+		return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+	}
+
+	return std::bit_cast<float>(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+}
+
+render::MeshBounds render::mesh_bounds(std::span<const Vertex> vertices)
+{
+	float min[3] = { 0.0f, 0.0f, 0.0f };
+	float max[3] = { 0.0f, 0.0f, 0.0f };
+	if (!vertices.empty())
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			min[i] = std::numeric_limits<float>::max();
+			max[i] = std::numeric_limits<float>::lowest();
+		}
+	}
+
+	for (auto& v : vertices)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			min[i] = std::min(min[i], v.position[i]);
+			max[i] = std::max(max[i], v.position[i]);
+		}
+	}
+
+	MeshBounds bounds = {};
+	for (int i = 0; i < 3; i++)
+	{
+		bounds.min[i] = min[i];
+		bounds.extent[i] = max[i] - min[i];
+	}
+
+	return bounds;
+}
+
+render::PackedMesh render::pack_mesh(std::span<const Vertex> vertices)
+{
+	return pack_mesh(vertices, mesh_bounds(vertices));
+}
+
+render::PackedMesh render::pack_mesh(std::span<const Vertex> vertices, const MeshBounds& bounds)
+{
+	PackedMesh mesh = {};
+	mesh.bounds = bounds;
+
+	mesh.vertices.reserve(vertices.size());
+	for (auto& v : vertices)
+	{
+		PackedVertex packed = {};
+
+		for (int i = 0; i < 3; i++)
+		{
+			// Flat axes all collapse onto min.
+			float extent = bounds.extent[i];
+			float t = extent > 0.0f ? (v.position[i] - bounds.min[i]) / extent : 0.0f;
+			packed.position[i] = to_unorm16(t);
+		}
+		packed.position[3] = v.tangent[3] < 0.0f ? 0 : 65535;
+
+		encode_octahedral(v.normal, packed.normal);
+		encode_octahedral(v.tangent, packed.tangent);
+
+		packed.uv[0] = float_to_half(v.uv[0]);
+		packed.uv[1] = float_to_half(v.uv[1]);
+
+		mesh.vertices.push_back(packed);
+	}
+
+	return mesh;
+}
+
+glm::mat4 render::unpack_transform(const MeshBounds& bounds)
+{
+	glm::mat4 transform(1.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		// Flat axes only ever decode 0, so any scale works, and 1 keeps the matrix invertible.
+		transform[i][i] = bounds.extent[i] > 0.0f ? bounds.extent[i] : 1.0f;
+		transform[3][i] = bounds.min[i];
+	}
+
+	return transform;
+}
+
+void check_close(const char* what, float expected, float actual, float tolerance)
+{
+	if (!(std::abs(expected - actual) <= tolerance))
+	{
+		throw std::runtime_error(fmt::format("Mesh packing check failed: {} {} came back as {} (tolerance {}).", what, expected, actual, tolerance));
+	}
+}
+
+void render::check_mesh_packing()
+{
+	const float s = 0.57735027f;
+	const Vertex vertices[] = {
+		{ { -3.0f, 0.5f, 10.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+		{ { 5.0f, 0.5f, -2.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f, -1.0f }, { 1.0f, 0.5f } },
+		{ { 1.234f, 0.5f, 3.21f }, { s, s, s }, { -s, s, -s, 1.0f }, { -2.75f, 1000.25f } },
+		{ { 0.001f, 0.5f, 9.999f }, { 0.6f, 0.0f, -0.8f }, { s, -s, -s, -1.0f }, { 0.1f, 1e-5f } },
+	};
+
+	PackedMesh mesh = pack_mesh(vertices);
+
+	for (size_t i = 0; i < std::size(vertices); i++)
+	{
+		const Vertex& v = vertices[i];
+		const PackedVertex& packed = mesh.vertices[i];
+
+		// Half a unorm16 step of the extent. y is flat, which has to decode exactly.
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float decoded = mesh.bounds.min[axis] + packed.position[axis] / 65535.0f * mesh.bounds.extent[axis];
+			check_close("position", v.position[axis], decoded, mesh.bounds.extent[axis] / 65535.0f * 0.5f + 1e-5f);
+		}
+
+		float bitangent_sign = packed.position[3] / 65535.0f * 2.0f - 1.0f;
+		check_close("bitangent sign", v.tangent[3], bitangent_sign, 0.0f);
+
+		float normal[3];
+		float tangent[3];
+		decode_octahedral(packed.normal, normal);
+		decode_octahedral(packed.tangent, tangent);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			check_close("normal", v.normal[axis], normal[axis], 1e-3f);
+			check_close("tangent", v.tangent[axis], tangent[axis], 1e-3f);
+		}
+
+		// Halves keep 11 significant bits, with subnormals below 2^-14.
+		for (int axis = 0; axis < 2; axis++)
+		{
+			float decoded = half_to_float(packed.uv[axis]);
+			check_close("uv", v.uv[axis], decoded, std::abs(v.uv[axis]) / 2048.0f + 1.0f / (1 << 25));
+		}
+	}
+}
+
+vk::VertexLayout render::packed_vertex_layout(uint32_t binding)
+{
+	vk::VertexLayout layout;
+	layout.binding(binding, sizeof(PackedVertex))
+		.attribute(UGO_PACKED_VERTEX_POSITION_LOCATION, binding, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position))
+		.attribute(UGO_PACKED_VERTEX_NORMAL_LOCATION, binding, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal))
+		.attribute(UGO_PACKED_VERTEX_TANGENT_LOCATION, binding, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, tangent))
+		.attribute(UGO_PACKED_VERTEX_UV_LOCATION, binding, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv));
+
+	return layout;
+}
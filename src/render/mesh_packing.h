@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vk/pipeline_builder.h"
+
+namespace render {
+
+	// Full precision vertex, as it comes out of an asset. 48 bytes.
+	struct Vertex {
+		float position[3];
+		float normal[3];
+		// xyz is the tangent, w is the bitangent sign.
+		float tangent[4];
+		float uv[2];
+	};
+
+	// What actually goes to the GPU. 20 bytes.
+	struct PackedVertex {
+		// Unorm16 position inside the mesh bounds. w holds the bitangent sign, 0 for -1 and 1 for +1.
+		uint16_t position[4];
+		// Octahedral snorm16.
+		int16_t normal[2];
+		int16_t tangent[2];
+		// Half floats.
+		uint16_t uv[2];
+	};
+
+	static_assert(sizeof(PackedVertex) == 20);
+
+	// Positions decode as min + unorm * extent. Fold this into the model matrix, or hand it to the decode
+	// helpers in packed_vertex.glsl.
+	struct MeshBounds {
+		float min[3];
+		float extent[3];
+	};
+
+	struct PackedMesh {
+		std::vector<PackedVertex> vertices;
+		MeshBounds bounds;
+	};
+
+	PackedMesh pack_mesh(std::span<const Vertex> vertices);
+	// Packs into the given bounds instead of the vertices' own, e.g. so a mesh's LODs can share one. Positions
+	// outside of it get clamped.
+	PackedMesh pack_mesh(std::span<const Vertex> vertices, const MeshBounds& bounds);
+	MeshBounds mesh_bounds(std::span<const Vertex> vertices);
+
+	// Takes decoded unorm positions back into mesh space, for folding into instance transforms.
+	glm::mat4 unpack_transform(const MeshBounds& bounds);
+
+	// Round trips known values through every encoder above and throws if any come back further off than their format
+	// allows. Cheap, so it can run at startup.
+	void check_mesh_packing();
+
+	// Matches the attributes declared by the generated packed_vertex.glsl.
+	vk::VertexLayout packed_vertex_layout(uint32_t binding = 0);
+
+	void encode_octahedral(const float v[3], int16_t out[2]);
+	void decode_octahedral(const int16_t e[2], float out[3]);
+
+	uint16_t float_to_half(float f);
+	float half_to_float(uint16_t h);
+
+}
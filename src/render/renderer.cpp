@@ -0,0 +1,772 @@
+#include "renderer.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include "core/job_system.h"
+#include "logger.h"
+#include "vk/context.h"
+#include "vk/device.h"
+#include "vk/sampler_cache.h"
+#include "vk/vulkan_error.h"
+
+VkRenderingAttachmentInfo create_color_attachment_info(VkImageView view, std::optional<VkClearValue> clear, VkImageLayout layout)
+{
+	VkRenderingAttachmentInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+
+	info.imageView = view;
+	info.imageLayout = layout;
+
+	if (clear.has_value()) {
+		info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		info.clearValue = clear.value();
+	}
+	else {
+		info.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	}
+
+	info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	return info;
+}
+
+// Loads what the prepass left if there's no clear. Always stored, the Hi-Z is built from it.
+VkRenderingAttachmentInfo create_depth_attachment_info(VkImageView view, std::optional<float> clear_depth, VkImageLayout layout)
+{
+	VkRenderingAttachmentInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+
+	info.imageView = view;
+	info.imageLayout = layout;
+
+	if (clear_depth.has_value()) {
+		info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		info.clearValue.depthStencil.depth = clear_depth.value();
+	}
+	else {
+		info.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	}
+
+	info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	return info;
+}
+
+VkSubmitInfo2 create_submit_info(VkCommandBufferSubmitInfo* buffer_submit, VkSemaphoreSubmitInfo* wait, VkSemaphoreSubmitInfo* signals, uint32_t signal_count)
+{
+	VkSubmitInfo2 info = {};
+	info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+
+	info.commandBufferInfoCount = 1;
+	info.pCommandBufferInfos = buffer_submit;
+
+	info.waitSemaphoreInfoCount = wait != nullptr ? 1 : 0;
+	info.pWaitSemaphoreInfos = wait;
+
+	info.signalSemaphoreInfoCount = signal_count;
+	info.pSignalSemaphoreInfos = signals;
+
+	return info;
+}
+
+VkRenderingInfo create_rendering_info(VkExtent2D extent, const VkRenderingAttachmentInfo* color, const VkRenderingAttachmentInfo* depth)
+{
+	VkRenderingInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+
+	info.colorAttachmentCount = color != nullptr ? 1 : 0;
+	info.pColorAttachments = color;
+	info.pDepthAttachment = depth;
+	info.layerCount = 1;
+	info.renderArea.extent = extent;
+	info.renderArea.offset = { 0, 0 };
+
+	return info;
+}
+
+void set_viewport(vk::CommandBuffer& cmd, VkExtent2D extent)
+{
+	VkViewport viewport = {};
+	viewport.width = extent.width;
+	viewport.height = extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	cmd.dispatch().vkCmdSetViewport(cmd.buffer(), 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.extent = extent;
+	cmd.dispatch().vkCmdSetScissor(cmd.buffer(), 0, 1, &scissor);
+}
+
+const uint64_t ONE_SEC_NS = 1000000000;
+
+// Lay depth down first, so the full pass only shades the visible fragment of each pixel.
+const bool USE_DEPTH_PREPASS = true;
+
+// Pull the scene's vertices out of the geometry pool in the shader, through its device address, instead of going
+// through the vertex input stage. Only the GpuScene pipelines, the props keep the draw queue's push constants.
+const bool USE_VERTEX_PULLING = false;
+
+// Matches the push constant block in scene_pulled.vert. scene.vert stops before vertices.
+struct SceneConstants {
+	glm::mat4 view_proj;
+	VkDeviceAddress instances;
+	VkDeviceAddress vertices;
+};
+
+// Everything renders into an HDR image at its own resolution, which gets scaled onto the swapchain at the end of the frame.
+// The resolution follows GPU frame time, see render::DynamicResolution.
+const VkFormat DRAW_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+// Matches the push constant block in upscale.frag.
+struct UpscaleConstants {
+	uint32_t draw_texture;
+	uint32_t draw_sampler;
+	float draw_size[2];
+	float inv_image_size[2];
+};
+
+VkExtent2D scale_extent(VkExtent2D extent, float scale)
+{
+	return {
+		std::max(static_cast<uint32_t>(extent.width * scale), 1u),
+		std::max(static_cast<uint32_t>(extent.height * scale), 1u),
+	};
+}
+
+// Pass order within a frame, for attachment lifetimes. The upscale pass after them doesn't use any pooled attachments.
+const uint32_t DEPTH_PREPASS = 0;
+const uint32_t SCENE_PASS = 1;
+const uint32_t HIZ_PASS = 2;
+
+const uint32_t MAX_POOL_VERTICES = 1 << 20;
+const uint32_t MAX_POOL_INDICES = 1 << 22;
+const uint32_t MAX_SCENE_MESHES = 1024;
+const uint32_t MAX_SCENE_INSTANCES = 1 << 16;
+
+render::Renderer::Renderer(vk::Context& context) :
+	_context(context),
+	_device(context.device()),
+	_depth_format(vk::find_depth_format(context.device())),
+	_swap_extent(context.swapchain().get_swap_extent()),
+	_resolution(_resolution_settings),
+	_draw_image_extent(scale_extent(_swap_extent, _resolution_settings.max_scale)),
+	_uploader(context.device()),
+	_geometry(context.device(), sizeof(PackedVertex), MAX_POOL_VERTICES, MAX_POOL_INDICES),
+	_scene(context.device(), MAX_SCENE_MESHES, MAX_SCENE_INSTANCES),
+	_draw_queue(context.device()),
+	_draw_image(context.device().resources().add(vk::Image(context.device(), DRAW_FORMAT, _draw_image_extent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT))),
+	_attachments(context.device()),
+	_hiz(context.device(), _draw_image_extent),
+	_frame_allocator(context.device(), 1),
+	_frame_timer(context.device(), 1),
+	_command_pool(context.device().alloc_graphics_pool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+	_cmd(context.device(), _command_pool),
+	_present_cmd(context.device(), _command_pool),
+	_render_fence(context.device(), VK_FENCE_CREATE_SIGNALED_BIT),
+	_swap_acquired(context.device(), 0),
+	_render_complete(context.device(), 0)
+{
+	vk::VertexLayout vertex_layout = packed_vertex_layout();
+	const char* scene_vertex_shader = USE_VERTEX_PULLING ? "shader/scene_pulled.vert.spv" : "shader/scene.vert.spv";
+
+	// Same vertex shader as the scene pipeline, so both passes come up with exactly the same depth.
+	vk::PipelineBuilder depth_builder(_device);
+	depth_builder.set_vertex_shader_from_file(scene_vertex_shader);
+	depth_builder.set_depth_format(_depth_format);
+	depth_builder.set_depth_test(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+	if (!USE_VERTEX_PULLING)
+	{
+		depth_builder.set_vertex_layout(vertex_layout);
+	}
+	// Every pipeline shares the bindless layout.
+	depth_builder.set_layout(_device.bindless().layout());
+	depth_builder.set_push_constants<SceneConstants>();
+
+	vk::PipelineBuilder scene_builder(_device);
+	scene_builder.set_vertex_shader_from_file(scene_vertex_shader);
+	scene_builder.set_fragment_shader_from_file("shader/tri.frag.spv");
+	scene_builder.set_color_format(DRAW_FORMAT);
+	scene_builder.set_depth_format(_depth_format);
+	// With the prepass, only the fragment that won gets shaded.
+	if (USE_DEPTH_PREPASS)
+	{
+		scene_builder.set_depth_test(false, VK_COMPARE_OP_EQUAL);
+	}
+	else
+	{
+		scene_builder.set_depth_test(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+	}
+	if (!USE_VERTEX_PULLING)
+	{
+		scene_builder.set_vertex_layout(vertex_layout);
+	}
+	scene_builder.set_layout(_device.bindless().layout());
+	scene_builder.set_push_constants<SceneConstants>();
+
+	vk::PipelineBuilder upscale_builder(_device);
+	upscale_builder.set_vertex_shader_from_file("shader/fullscreen.vert.spv");
+	upscale_builder.set_fragment_shader_from_file("shader/upscale.frag.spv");
+	upscale_builder.set_color_format(context.swapchain().surface_format());
+	upscale_builder.set_depth_format(VK_FORMAT_UNDEFINED);
+	upscale_builder.set_layout(_device.bindless().layout());
+	upscale_builder.set_push_constants<UpscaleConstants>();
+
+	// The props' versions of the depth and scene pipelines, which take the queue's constants and a material.
+	vk::PipelineBuilder prop_depth_builder(_device);
+	prop_depth_builder.set_vertex_shader_from_file("shader/scene.vert.spv");
+	prop_depth_builder.set_depth_format(_depth_format);
+	prop_depth_builder.set_depth_test(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+	prop_depth_builder.set_vertex_layout(vertex_layout);
+	prop_depth_builder.set_layout(_device.bindless().layout());
+	prop_depth_builder.set_push_constants<DrawQueueConstants>();
+
+	vk::PipelineBuilder prop_builder(_device);
+	prop_builder.set_vertex_shader_from_file("shader/scene.vert.spv");
+	prop_builder.set_fragment_shader_from_file("shader/prop.frag.spv");
+	prop_builder.set_color_format(DRAW_FORMAT);
+	prop_builder.set_depth_format(_depth_format);
+	if (USE_DEPTH_PREPASS)
+	{
+		prop_builder.set_depth_test(false, VK_COMPARE_OP_EQUAL);
+	}
+	else
+	{
+		prop_builder.set_depth_test(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+	}
+	prop_builder.set_vertex_layout(vertex_layout);
+	prop_builder.set_layout(_device.bindless().layout());
+	prop_builder.set_push_constants<DrawQueueConstants>();
+
+	// Driver compiles are the slow part of startup and don't depend on each other.
+	core::JobSystem& jobs = core::JobSystem::get();
+	vk::ResourcePools& resources = _device.resources();
+	core::JobCounter pipeline_builds;
+	jobs.run([&]() { _depth_pipeline = resources.add(depth_builder.build()); }, pipeline_builds);
+	jobs.run([&]() { _scene_pipeline = resources.add(scene_builder.build()); }, pipeline_builds);
+	jobs.run([&]() { _upscale_pipeline = resources.add(upscale_builder.build()); }, pipeline_builds);
+	jobs.run([&]() { _prop_depth_pipeline = resources.add(prop_depth_builder.build()); }, pipeline_builds);
+	jobs.run([&]() { _prop_pipeline = resources.add(prop_builder.build()); }, pipeline_builds);
+	jobs.wait(pipeline_builds);
+
+	_queue_geometry = _draw_queue.add_geometry(_geometry);
+	_queue_depth_pipeline = _draw_queue.add_pipeline(resources.get(_prop_depth_pipeline));
+	_queue_prop_pipeline = _draw_queue.add_pipeline(resources.get(_prop_pipeline));
+
+	// Sampled by the Hi-Z build, so it can't be transient.
+	_depth_id = _attachments.add(_depth_format, _draw_image_extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, DEPTH_PREPASS, HIZ_PASS);
+	_attachments.build();
+
+	_draw_texture = _device.bindless().add_sampled_image(resources.get(_draw_image).view());
+	_depth_texture = _device.bindless().add_sampled_image(_attachments.get(_depth_id).view());
+	_linear_sampler = resources.add_sampler(vk::sampler_info(_device, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE));
+
+	this->add_scene_content();
+}
+
+render::Renderer::~Renderer()
+{
+	// Members are destroyed after this, so everything has to be finished first, including the last present, which
+	// neither the fence nor the deletion queue's timeline covers. It's shutdown, so just wait for the whole device.
+	auto result = _device.dispatch().vkDeviceWaitIdle(_device.device());
+	if (result != VK_SUCCESS)
+	{
+		// Can't throw from a destructor. If the device is lost there's nothing left running to wait for anyway.
+		log_error("Waiting for the device to go idle failed with {}.", static_cast<int>(result));
+	}
+
+	vk::ResourcePools& resources = _device.resources();
+	resources.remove(_depth_pipeline);
+	resources.remove(_scene_pipeline);
+	resources.remove(_upscale_pipeline);
+	resources.remove(_prop_depth_pipeline);
+	resources.remove(_prop_pipeline);
+	resources.remove(_draw_image);
+	resources.remove(_linear_sampler);
+
+	_device.dispatch().vkDestroyCommandPool(_device.device(), _command_pool, _device.allocation_callbacks());
+
+	_device.bindless().remove_sampled_image(_draw_texture);
+	_device.bindless().remove_sampled_image(_depth_texture);
+}
+
+const glm::vec3 CUBE_CORNERS[] = {
+	{-1.0f, -1.0f, -1.0f},
+	{1.0f, -1.0f, -1.0f},
+	{1.0f, 1.0f, -1.0f},
+	{-1.0f, 1.0f, -1.0f},
+	{-1.0f, -1.0f, 1.0f},
+	{1.0f, -1.0f, 1.0f},
+	{1.0f, 1.0f, 1.0f},
+	{-1.0f, 1.0f, 1.0f},
+};
+
+const uint32_t CUBE_INDICES[] = {
+	0, 1, 2, 2, 3, 0,
+	4, 6, 5, 6, 4, 7,
+	0, 3, 7, 7, 4, 0,
+	1, 5, 6, 6, 2, 1,
+	0, 4, 5, 5, 1, 0,
+	3, 2, 6, 6, 7, 3,
+};
+
+render::Vertex make_vertex(glm::vec3 position, glm::vec3 normal, glm::vec3 tangent, glm::vec2 uv)
+{
+	return { {position.x, position.y, position.z}, {normal.x, normal.y, normal.z}, {tangent.x, tangent.y, tangent.z, 1.0f}, {uv.x, uv.y} };
+}
+
+// Corners are shared between faces, so normals point out through the corners.
+void make_cube(std::vector<render::Vertex>& vertices)
+{
+	vertices.clear();
+
+	for (const glm::vec3& corner : CUBE_CORNERS)
+	{
+		glm::vec3 normal = glm::normalize(corner);
+		glm::vec3 tangent = glm::normalize(glm::vec3(corner.z, 0.0f, -corner.x));
+		vertices.push_back(make_vertex(corner, normal, tangent, glm::vec2(corner) * 0.5f + 0.5f));
+	}
+}
+
+// A UV sphere. Used at a few resolutions to have something worth switching LODs on.
+void make_sphere(uint32_t segments, std::vector<render::Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	uint32_t rings = std::max(segments / 2, 2u);
+	vertices.clear();
+	indices.clear();
+
+	for (uint32_t ring = 0; ring <= rings; ring++)
+	{
+		float theta = glm::pi<float>() * ring / rings;
+		for (uint32_t segment = 0; segment <= segments; segment++)
+		{
+			float phi = 2.0f * glm::pi<float>() * segment / segments;
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			glm::vec3 tangent(-std::sin(phi), 0.0f, std::cos(phi));
+			glm::vec2 uv(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+
+			vertices.push_back(make_vertex(normal, normal, tangent, uv));
+		}
+	}
+
+	for (uint32_t ring = 0; ring < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t a = ring * (segments + 1) + segment;
+			uint32_t b = a + segments + 1;
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+}
+
+// Segment counts and the screen size each one holds down to, most detailed first.
+const uint32_t SPHERE_LOD_SEGMENTS[] = { 48, 24, 12, 6 };
+const float SPHERE_LOD_SCREEN_SIZES[] = { 0.15f, 0.05f, 0.015f, 0.0f };
+// LODs share transforms, so they have to share the box they're packed into. The coarse ones don't reach all of it.
+const render::MeshBounds SPHERE_PACKING = { {-1.0f, -1.0f, -1.0f}, {2.0f, 2.0f, 2.0f} };
+
+// A city of boxes with balls on some of the roofs, big and dense enough that most of it is either off screen or
+// hidden at any time.
+const int CITY_SIZE = 128;
+const float CITY_SPACING = 4.0f;
+
+const float ROOF_BALL_ORBIT = 1.0f;
+const float ROOF_BALL_SCALE = 0.6f;
+// In the ball's space, so scaled along with it.
+const float MOON_ORBIT = 2.0f;
+const float MOON_SCALE = 0.4f;
+
+// Markers floating over the street corners around the centre of the city.
+const int PROP_GRID_SIZE = 32;
+const float PROP_SCALE = 0.3f;
+const render::MaterialId PROP_MATERIALS = 4;
+
+void render::Renderer::add_scene_content()
+{
+	// Every mesh goes into the pool packed, so make sure the packing holds up before relying on it.
+	check_mesh_packing();
+	// Same for the CPU culling kernels the props go through.
+	check_instance_culling();
+	log_debug("CPU culling with {}.", cull_isa_name(_props.isa()));
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	make_cube(vertices);
+	PackedMesh packed_cube = pack_mesh(vertices);
+	MeshRange cube_range = _geometry.add_mesh(_uploader, packed_cube, CUBE_INDICES);
+	MeshId cube = _scene.add_mesh(cube_range, glm::vec4(0.0f, 0.0f, 0.0f, std::sqrt(3.0f)), packed_cube.bounds);
+
+	std::vector<MeshLod> sphere_lods;
+	for (size_t i = 0; i < std::size(SPHERE_LOD_SEGMENTS); i++)
+	{
+		make_sphere(SPHERE_LOD_SEGMENTS[i], vertices, indices);
+		MeshRange range = _geometry.add_mesh(_uploader, pack_mesh(vertices, SPHERE_PACKING), indices);
+		sphere_lods.push_back({ range, SPHERE_LOD_SCREEN_SIZES[i] });
+	}
+	MeshId sphere = _scene.add_mesh(sphere_lods, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), SPHERE_PACKING);
+
+	for (int z = 0; z < CITY_SIZE; z++)
+	{
+		for (int x = 0; x < CITY_SIZE; x++)
+		{
+			float height = 1.0f + static_cast<float>((x * 7 + z * 13) % 5);
+			glm::vec3 position((x - CITY_SIZE / 2) * CITY_SPACING, height, (z - CITY_SIZE / 2) * CITY_SPACING);
+
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+			transform = glm::scale(transform, glm::vec3(1.0f, height, 1.0f));
+			_scene.add_instance(cube, transform);
+
+			if ((x + z) % 3 == 0)
+			{
+				RoofSpinner spinner = {};
+				spinner.roof = position + glm::vec3(0.0f, height + 1.0f, 0.0f);
+				spinner.phase = static_cast<float>(x * 7 + z * 3);
+
+				// Transforms are filled in by the scene graph's first update.
+				glm::mat4 moon_local = glm::translate(glm::mat4(1.0f), glm::vec3(MOON_ORBIT, 0.0f, 0.0f));
+				moon_local = glm::scale(moon_local, glm::vec3(MOON_SCALE));
+
+				spinner.pivot = _scene_graph.add_node(glm::mat4(1.0f));
+				spinner.ball = _scene_graph.add_node(glm::mat4(1.0f), spinner.pivot);
+				NodeId moon = _scene_graph.add_node(moon_local, spinner.ball);
+
+				_scene_graph.attach_instance(spinner.ball, _scene.add_instance(sphere, glm::mat4(1.0f)));
+				_scene_graph.attach_instance(moon, _scene.add_instance(sphere, glm::mat4(1.0f)));
+				_roof_spinners.push_back(spinner);
+			}
+		}
+	}
+
+	// The props use a cheap sphere, they're never big on screen. Every prop is one of 8 mesh and material pairs,
+	// so the queue instances them down to a handful of draws.
+	DrawMeshId prop_meshes[] = {
+		_draw_queue.add_mesh(_queue_geometry, cube_range, packed_cube.bounds),
+		_draw_queue.add_mesh(_queue_geometry, sphere_lods[2].range, SPHERE_PACKING),
+	};
+	glm::vec4 prop_bounds[] = { glm::vec4(0.0f, 0.0f, 0.0f, std::sqrt(3.0f)), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) };
+	for (int z = 0; z < PROP_GRID_SIZE; z++)
+	{
+		for (int x = 0; x < PROP_GRID_SIZE; x++)
+		{
+			int shape = (x + z) % 2;
+			float height = 8.0f + static_cast<float>((x * 5 + z * 3) % 4);
+			glm::vec3 position((x - PROP_GRID_SIZE / 2 + 0.5f) * CITY_SPACING, height, (z - PROP_GRID_SIZE / 2 + 0.5f) * CITY_SPACING);
+
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+			transform = glm::scale(transform, glm::vec3(PROP_SCALE));
+			_props.add(prop_bounds[shape], transform);
+
+			MaterialId material = static_cast<MaterialId>((x * 3 + z) % PROP_MATERIALS);
+			_prop_draws.push_back({ prop_meshes[shape], material });
+		}
+	}
+
+	_scene.upload(_uploader);
+	_uploader.flush();
+}
+
+render::CullCamera render::Renderer::update_camera(VkExtent2D draw_extent, const sim::Snapshot& snapshot)
+{
+	// Circles the city centre at street level.
+	float angle = snapshot.camera_angle;
+	glm::vec3 eye(std::cos(angle) * snapshot.camera_distance, snapshot.camera_height, std::sin(angle) * snapshot.camera_distance);
+	glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	float aspect = static_cast<float>(draw_extent.width) / static_cast<float>(draw_extent.height);
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 500.0f);
+	// Vulkan's clip space has y pointing down.
+	proj[1][1] *= -1.0f;
+
+	CullCamera camera = {};
+	camera.view_proj = proj * view;
+	camera.position = eye;
+	camera.projection_scale = std::abs(proj[1][1]);
+	// Fewer pixels need less detail.
+	camera.lod_scale = _resolution.scale();
+
+	return camera;
+}
+
+void render::Renderer::queue_props(const CullCamera& camera)
+{
+	_props.cull(frustum_planes(camera.view_proj), _visible_props);
+
+	for (uint32_t prop : _visible_props)
+	{
+		DrawPacket packet = {};
+		packet.mesh = _prop_draws[prop].mesh;
+		packet.material = _prop_draws[prop].material;
+		packet.transform = _props.transform(prop);
+		packet.depth = glm::distance(camera.position, glm::vec3(packet.transform[3]));
+
+		// Depth only has one material, so the prepass sorts by mesh and then front to back within each mesh. Sorting purely
+		// by depth would interleave the meshes and undo the instancing, for little early-z gain on props this small.
+		if (USE_DEPTH_PREPASS)
+		{
+			DrawPacket depth_packet = packet;
+			depth_packet.pass = DEPTH_PREPASS;
+			depth_packet.pipeline = _queue_depth_pipeline;
+			depth_packet.material = 0;
+			_draw_queue.submit(depth_packet);
+		}
+
+		packet.pass = SCENE_PASS;
+		packet.pipeline = _queue_prop_pipeline;
+		_draw_queue.submit(packet);
+	}
+}
+
+void render::Renderer::animate_scene(double time)
+{
+	float seconds = static_cast<float>(time);
+
+	// Only the pivots and balls are touched, the moons follow through the hierarchy.
+	for (const RoofSpinner& spinner : _roof_spinners)
+	{
+		float angle = seconds * 0.5f + spinner.phase;
+
+		glm::mat4 pivot = glm::translate(glm::mat4(1.0f), spinner.roof);
+		pivot = glm::rotate(pivot, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+		_scene_graph.set_local(spinner.pivot, pivot);
+
+		glm::mat4 ball = glm::translate(glm::mat4(1.0f), glm::vec3(ROOF_BALL_ORBIT, 0.0f, 0.0f));
+		ball = glm::rotate(ball, angle * 3.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		ball = glm::scale(ball, glm::vec3(ROOF_BALL_SCALE));
+		_scene_graph.set_local(spinner.ball, ball);
+	}
+
+	_scene_graph.update(_scene);
+}
+
+// Frames between logging what the draw queue saved.
+const uint64_t DRAW_STATS_INTERVAL = 600;
+
+void render::Renderer::draw_frame(const sim::Snapshot& snapshot)
+{
+	auto& vkd = _device.dispatch();
+	vk::CommandBuffer& cmd = _cmd;
+
+	_render_fence.wait(ONE_SEC_NS);
+	_render_fence.reset();
+	_frame_allocator.begin_frame(0);
+	_device.deletion_queue().collect();
+
+	// Writes into the instance buffer, which the fence means the GPU is done with.
+	this->animate_scene(snapshot.time);
+
+	// The fence means last frame's timestamps are in.
+	if (auto gpu_ms = _frame_timer.read_ms(0))
+	{
+		_resolution.update(gpu_ms.value());
+	}
+	VkExtent2D draw_extent = scale_extent(_swap_extent, _resolution.scale());
+	CullCamera camera = this->update_camera(draw_extent, snapshot);
+	this->queue_props(camera);
+	DrawStats draw_stats;
+
+	// Everything up to the Hi-Z build goes in its own batch, which doesn't wait for the swapchain. That's also what gets
+	// timed, so waiting on vsync or for an image to come back doesn't count as GPU time.
+	cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	_frame_timer.begin(cmd, 0);
+
+	// Frustum and LODs with this frame's camera, occlusion against last frame's depth with last frame's camera.
+	// Nothing here loops over instances, that's all on the GPU.
+	_scene.cull(cmd, _frame_allocator, _hiz, camera, _prev_view_proj);
+
+	// The draw image's contents don't survive between frames, it's cleared every time.
+	vk::ImageBarrierState draw_discard_state = {};
+	draw_discard_state.stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	draw_discard_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	draw_discard_state.access = VK_ACCESS_2_NONE;
+
+	vk::ImageBarrierState draw_attachment_state = {};
+	draw_attachment_state.stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	draw_attachment_state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	draw_attachment_state.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+
+	// Last read by the Hi-Z build.
+	vk::ImageBarrierState depth_discard_state = {};
+	depth_discard_state.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	depth_discard_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depth_discard_state.access = VK_ACCESS_2_NONE;
+
+	vk::ImageBarrierState depth_attachment_state = {};
+	depth_attachment_state.stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+	depth_attachment_state.layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+	depth_attachment_state.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	vk::ImageBarrierState depth_read_state = {};
+	depth_read_state.stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	depth_read_state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depth_read_state.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+	vk::ImageBarrierState draw_read_state = {};
+	draw_read_state.stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	draw_read_state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	draw_read_state.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+	// Matches the stage the acquire semaphore is waited on at.
+	vk::ImageBarrierState swapchain_image_state = {};
+	swapchain_image_state.stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	swapchain_image_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	swapchain_image_state.access = VK_ACCESS_2_NONE;
+
+	vk::ImageBarrierState swapchain_attachment_state = {};
+	swapchain_attachment_state.stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	swapchain_attachment_state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	swapchain_attachment_state.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+
+	vk::ImageBarrierState present_image_state = {};
+	present_image_state.stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	present_image_state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	present_image_state.access = 0;
+
+	VkImageSubresourceRange image_range = vk::get_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
+	VkImageSubresourceRange depth_range = vk::get_image_range(VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	vk::ResourcePools& resources = _device.resources();
+	vk::Image& draw_image = resources.get(_draw_image);
+	vk::Image& depth_image = _attachments.get(_depth_id);
+
+	vk::transition_image(cmd, draw_image.image(), image_range, draw_discard_state, draw_attachment_state);
+	vk::transition_image(cmd, depth_image.image(), depth_range, depth_discard_state, depth_attachment_state);
+
+	SceneConstants scene_constants = {};
+	scene_constants.view_proj = camera.view_proj;
+	scene_constants.instances = _scene.instance_buffer().device_address();
+	scene_constants.vertices = _geometry.vertex_buffer().device_address();
+
+	if (USE_DEPTH_PREPASS)
+	{
+		VkRenderingAttachmentInfo prepass_depth_info = create_depth_attachment_info(depth_image.view(), 1.0f, depth_attachment_state.layout);
+		VkRenderingInfo prepass_info = create_rendering_info(draw_extent, nullptr, &prepass_depth_info);
+
+		vkd.vkCmdBeginRendering(cmd.buffer(), &prepass_info);
+
+		const vk::Pipeline& depth_pipeline = resources.get(_depth_pipeline);
+		cmd.bind_pipeline(depth_pipeline);
+		_device.bindless().bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS);
+		set_viewport(cmd, draw_extent);
+
+		_geometry.bind(cmd);
+		cmd.push(depth_pipeline, scene_constants, _frame_allocator);
+		_scene.draw(cmd);
+
+		draw_stats += _draw_queue.record(cmd, _frame_allocator, DEPTH_PREPASS, camera.view_proj);
+
+		vkd.vkCmdEndRendering(cmd.buffer());
+	}
+
+	VkClearColorValue clear_color;
+	clear_color = { {1.0f, (float)std::abs(std::sin((double)_frame_idx / 10)), 1.0f, 1.0f} };
+
+	VkRenderingAttachmentInfo color_attachment_info = create_color_attachment_info(draw_image.view(), VkClearValue { clear_color }, draw_attachment_state.layout);
+	std::optional<float> depth_clear = USE_DEPTH_PREPASS ? std::nullopt : std::optional<float>(1.0f);
+	VkRenderingAttachmentInfo depth_attachment_info = create_depth_attachment_info(depth_image.view(), depth_clear, depth_attachment_state.layout);
+	VkRenderingInfo rendering_info = create_rendering_info(draw_extent, &color_attachment_info, &depth_attachment_info);
+
+	vkd.vkCmdBeginRendering(cmd.buffer(), &rendering_info);
+
+	const vk::Pipeline& scene_pipeline = resources.get(_scene_pipeline);
+	cmd.bind_pipeline(scene_pipeline);
+	_device.bindless().bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS);
+	set_viewport(cmd, draw_extent);
+
+	// One bind for everything in the pool, one draw call for everything that survived culling.
+	_geometry.bind(cmd);
+	cmd.push(scene_pipeline, scene_constants, _frame_allocator);
+	_scene.draw(cmd);
+
+	draw_stats += _draw_queue.record(cmd, _frame_allocator, SCENE_PASS, camera.view_proj);
+	_draw_queue.clear();
+
+	vkd.vkCmdEndRendering(cmd.buffer());
+
+	// Next frame's culling tests against this.
+	vk::transition_image(cmd, depth_image.image(), depth_range, depth_attachment_state, depth_read_state);
+	_hiz.build(cmd, _depth_texture, draw_extent);
+
+	vk::transition_image(cmd, draw_image.image(), image_range, draw_attachment_state, draw_read_state);
+
+	_frame_timer.end(cmd, 0);
+	cmd.end();
+	_frame_allocator.flush();
+
+	VkCommandBufferSubmitInfo offscreen_buffer_info = cmd.submit_info();
+	VkSubmitInfo2 offscreen_submit_info = create_submit_info(&offscreen_buffer_info, nullptr, nullptr, 0);
+
+	auto result = vkd.vkQueueSubmit2(_device.graphics_queue(), 1, &offscreen_submit_info, VK_NULL_HANDLE);
+	vk_check(result);
+
+	uint32_t swap_image_idx = _context.swapchain().acquire_image(_swap_acquired);
+	VkImage swap_image = _context.swapchain().get_swapchain_image(swap_image_idx);
+
+	vk::CommandBuffer& present_cmd = _present_cmd;
+	present_cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	vk::transition_image(present_cmd, swap_image, image_range, swapchain_image_state, swapchain_attachment_state);
+
+	// Scale up onto the swapchain.
+	VkImageView swap_image_view = _context.swapchain().get_swapchain_image_view(swap_image_idx);
+	VkRenderingAttachmentInfo swap_attachment_info = create_color_attachment_info(swap_image_view, std::nullopt, swapchain_attachment_state.layout);
+	swap_attachment_info.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	VkRenderingInfo upscale_rendering_info = create_rendering_info(_swap_extent, &swap_attachment_info, nullptr);
+
+	vkd.vkCmdBeginRendering(present_cmd.buffer(), &upscale_rendering_info);
+
+	const vk::Pipeline& upscale_pipeline = resources.get(_upscale_pipeline);
+	present_cmd.bind_pipeline(upscale_pipeline);
+	set_viewport(present_cmd, _swap_extent);
+
+	UpscaleConstants upscale_constants = {};
+	upscale_constants.draw_texture = _draw_texture;
+	upscale_constants.draw_sampler = resources.bindless_index(_linear_sampler);
+	upscale_constants.draw_size[0] = draw_extent.width;
+	upscale_constants.draw_size[1] = draw_extent.height;
+	upscale_constants.inv_image_size[0] = 1.0f / _draw_image_extent.width;
+	upscale_constants.inv_image_size[1] = 1.0f / _draw_image_extent.height;
+	present_cmd.push(upscale_pipeline, upscale_constants);
+
+	present_cmd.draw(3, 1, 0, 0);
+
+	vkd.vkCmdEndRendering(present_cmd.buffer());
+
+	vk::transition_image(present_cmd, swap_image, image_range, swapchain_attachment_state, present_image_state);
+
+	present_cmd.end();
+
+	// Signals and the fence cover the offscreen batch too, it went in earlier on the same queue.
+	VkSemaphoreSubmitInfo wait_submit = _swap_acquired.submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+	// The deletion queue's timeline says when whatever was retired while recording this frame can go.
+	VkSemaphoreSubmitInfo signal_submits[] = {
+		_render_complete.submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT),
+		_device.deletion_queue().signal_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT),
+	};
+	VkCommandBufferSubmitInfo buffer_submit_info = present_cmd.submit_info();
+
+	VkSubmitInfo2 submit_info = create_submit_info(&buffer_submit_info, &wait_submit, signal_submits, 2);
+
+	result = vkd.vkQueueSubmit2(_device.graphics_queue(), 1, &submit_info, _render_fence.vk_fence());
+	vk_check(result);
+	_device.deletion_queue().submitted();
+
+	_context.swapchain().present(swap_image_idx, _device.graphics_queue(), _render_complete);
+
+	if (_frame_idx % DRAW_STATS_INTERVAL == 0)
+	{
+		log_debug("Draw queue: {} draws instanced into {} draw calls, {} binds skipped ({} pipeline, {} descriptor, {} material, {} geometry binds made)",
+			draw_stats.instances, draw_stats.draws, draw_stats.binds_skipped, draw_stats.pipeline_binds, draw_stats.descriptor_binds, draw_stats.material_binds, draw_stats.geometry_binds);
+	}
+
+	_prev_view_proj = camera.view_proj;
+	_frame_idx++;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "render/attachment_pool.h"
+#include "render/draw_queue.h"
+#include "render/dynamic_resolution.h"
+#include "render/geometry_pool.h"
+#include "render/gpu_scene.h"
+#include "render/hiz.h"
+#include "render/instance_store.h"
+#include "render/scene_graph.h"
+#include "sim/simulation.h"
+#include "vk/bindless.h"
+#include "vk/command_buffer.h"
+#include "vk/frame_allocator.h"
+#include "vk/gpu_timer.h"
+#include "vk/image.h"
+#include "vk/pipeline_builder.h"
+#include "vk/resource_pools.h"
+#include "vk/sync.h"
+#include "vk/uploader.h"
+
+namespace vk {
+	class Context;
+	class Device;
+}
+
+namespace render {
+
+	// Owns everything a frame needs and draws them onto the context's swapchain.
+	// A frame goes: cull against last frame's Hi-Z, depth prepass, scene, Hi-Z build for the next frame, upscale.
+	class Renderer {
+	public:
+		Renderer(vk::Context& context);
+		// Waits for the GPU before anything is destroyed.
+		~Renderer();
+
+		Renderer& operator=(const Renderer& other) = delete;
+		Renderer(const Renderer& other) = delete;
+
+		// Draws the scene as the snapshot has it.
+		void draw_frame(const sim::Snapshot& snapshot);
+
+	private:
+		void add_scene_content();
+		CullCamera update_camera(VkExtent2D draw_extent, const sim::Snapshot& snapshot);
+		void queue_props(const CullCamera& camera);
+		void animate_scene(double time);
+
+		vk::Context& _context;
+		vk::Device& _device;
+
+		VkFormat _depth_format;
+		VkExtent2D _swap_extent;
+		DynamicResolutionSettings _resolution_settings;
+		DynamicResolution _resolution;
+		// Allocated once at the biggest scale, lower resolutions just render into the top left corner of it.
+		VkExtent2D _draw_image_extent;
+
+		vk::PipelineHandle _depth_pipeline;
+		vk::PipelineHandle _scene_pipeline;
+		vk::PipelineHandle _upscale_pipeline;
+		vk::PipelineHandle _prop_depth_pipeline;
+		vk::PipelineHandle _prop_pipeline;
+
+		vk::Uploader _uploader;
+		GeometryPool _geometry;
+		GpuScene _scene;
+
+		// Balls orbiting the roofs they sit on, each with a moon orbiting it in turn.
+		struct RoofSpinner {
+			NodeId pivot;
+			NodeId ball;
+			glm::vec3 roof;
+			float phase;
+		};
+		SceneGraph _scene_graph;
+		std::vector<RoofSpinner> _roof_spinners;
+
+		// A few props culled and drawn from the CPU, through the draw queue rather than GpuScene.
+		struct PropDraw {
+			DrawMeshId mesh;
+			MaterialId material;
+		};
+		InstanceStore _props;
+		std::vector<PropDraw> _prop_draws;
+		std::vector<uint32_t> _visible_props;
+		DrawQueue _draw_queue;
+		GeometryId _queue_geometry;
+		PipelineId _queue_depth_pipeline;
+		PipelineId _queue_prop_pipeline;
+
+		vk::ImageHandle _draw_image;
+		AttachmentPool _attachments;
+		AttachmentId _depth_id;
+		HiZ _hiz;
+
+		vk::BindlessIndex _draw_texture;
+		vk::BindlessIndex _depth_texture;
+		vk::SamplerHandle _linear_sampler;
+
+		// Only one frame in flight for now.
+		vk::FrameAllocator _frame_allocator;
+		vk::GpuTimer _frame_timer;
+
+		VkCommandPool _command_pool;
+		vk::CommandBuffer _cmd;
+		vk::CommandBuffer _present_cmd;
+
+		vk::Fence _render_fence;
+		vk::Semaphore _swap_acquired;
+		vk::Semaphore _render_complete;
+
+		// What the Hi-Z was drawn with.
+		glm::mat4 _prev_view_proj = glm::mat4(1.0f);
+		uint64_t _frame_idx = 0;
+	};
+
+}
@@ -0,0 +1,253 @@
+#include "scene_graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "core/parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define UGO_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define UGO_TRANSFORM_NEON 1
+#include <arm_neon.h>
+#endif
+
+const uint32_t NO_SLOT = UINT32_MAX;
+const render::InstanceId NO_INSTANCE = UINT32_MAX;
+
+// Nodes per thread within a level. A node is a 4x4 multiply, so anything less isn't worth waking another thread for.
+const uint32_t UPDATE_GRAIN = 2048;
+
+// out = a * b, column major like glm. out can't be a or b.
+void multiply_transforms(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+	const float* lhs = &a[0][0];
+	const float* rhs = &b[0][0];
+	float* result = &out[0][0];
+
+	// Each column of the result is a's columns weighted by the matching column of b.
+#if defined(UGO_TRANSFORM_SSE)
+	__m128 a0 = _mm_loadu_ps(lhs);
+	__m128 a1 = _mm_loadu_ps(lhs + 4);
+	__m128 a2 = _mm_loadu_ps(lhs + 8);
+	__m128 a3 = _mm_loadu_ps(lhs + 12);
+
+	for (int c = 0; c < 4; c++)
+	{
+		const float* column = rhs + c * 4;
+		__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+		_mm_storeu_ps(result + c * 4, sum);
+	}
+#elif defined(UGO_TRANSFORM_NEON)
+	float32x4_t a0 = vld1q_f32(lhs);
+	float32x4_t a1 = vld1q_f32(lhs + 4);
+	float32x4_t a2 = vld1q_f32(lhs + 8);
+	float32x4_t a3 = vld1q_f32(lhs + 12);
+
+	for (int c = 0; c < 4; c++)
+	{
+		float32x4_t column = vld1q_f32(rhs + c * 4);
+		float32x4_t sum = vmulq_laneq_f32(a0, column, 0);
+		sum = vfmaq_laneq_f32(sum, a1, column, 1);
+		sum = vfmaq_laneq_f32(sum, a2, column, 2);
+		sum = vfmaq_laneq_f32(sum, a3, column, 3);
+		vst1q_f32(result + c * 4, sum);
+	}
+#else
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			result[c * 4 + r] = lhs[r] * rhs[c * 4] + lhs[4 + r] * rhs[c * 4 + 1] + lhs[8 + r] * rhs[c * 4 + 2] + lhs[12 + r] * rhs[c * 4 + 3];
+		}
+	}
+#endif
+}
+
+render::NodeId render::SceneGraph::add_node(const glm::mat4& local, NodeId parent)
+{
+	uint32_t depth = 0;
+	uint32_t parent_slot = NO_SLOT;
+	if (parent != NO_NODE)
+	{
+		if (parent >= this->size())
+		{
+			throw std::runtime_error(fmt::format("No scene node {} to parent to.", parent));
+		}
+
+		depth = _node_depth[parent] + 1;
+		parent_slot = _node_slot[parent];
+	}
+
+	NodeId node = this->size();
+	uint32_t slot = static_cast<uint32_t>(_slot_node.size());
+
+	_node_slot.push_back(slot);
+	_node_depth.push_back(depth);
+
+	_slot_node.push_back(node);
+	_parent_slot.push_back(parent_slot);
+	_local.push_back(local);
+	_world.push_back(local);
+	_instance.push_back(NO_INSTANCE);
+	_dirty.push_back(1);
+
+	_min_dirty_depth = std::min(_min_dirty_depth, depth);
+	_sorted = false;
+
+	return node;
+}
+
+void render::SceneGraph::attach_instance(NodeId node, InstanceId instance)
+{
+	uint32_t slot = _node_slot[node];
+	_instance[slot] = instance;
+	_instance_end = std::max(_instance_end, instance + 1);
+
+	// Gets its transform written on the next update even if nothing moves.
+	_dirty[slot] = 1;
+	_min_dirty_depth = std::min(_min_dirty_depth, _node_depth[node]);
+}
+
+void render::SceneGraph::set_local(NodeId node, const glm::mat4& local)
+{
+	uint32_t slot = _node_slot[node];
+	_local[slot] = local;
+	_dirty[slot] = 1;
+	_min_dirty_depth = std::min(_min_dirty_depth, _node_depth[node]);
+}
+
+void render::SceneGraph::sort_by_depth()
+{
+	uint32_t count = static_cast<uint32_t>(_slot_node.size());
+	uint32_t levels = 0;
+	for (uint32_t depth : _node_depth)
+	{
+		levels = std::max(levels, depth + 1);
+	}
+
+	// Counting sort, which keeps siblings in the order they were added.
+	_level_starts.assign(levels + 1, 0);
+	for (NodeId node : _slot_node)
+	{
+		_level_starts[_node_depth[node] + 1]++;
+	}
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		_level_starts[level + 1] += _level_starts[level];
+	}
+
+	std::vector<uint32_t> next(_level_starts.begin(), _level_starts.end() - 1);
+	std::vector<uint32_t> moved_to(count);
+	for (uint32_t slot = 0; slot < count; slot++)
+	{
+		moved_to[slot] = next[_node_depth[_slot_node[slot]]]++;
+	}
+
+	std::vector<NodeId> slot_node(count);
+	std::vector<uint32_t> parent_slot(count);
+	std::vector<glm::mat4> local(count);
+	std::vector<glm::mat4> world(count);
+	std::vector<InstanceId> instance(count);
+	std::vector<uint8_t> dirty(count);
+	for (uint32_t slot = 0; slot < count; slot++)
+	{
+		uint32_t to = moved_to[slot];
+		slot_node[to] = _slot_node[slot];
+		parent_slot[to] = _parent_slot[slot] != NO_SLOT ? moved_to[_parent_slot[slot]] : NO_SLOT;
+		local[to] = _local[slot];
+		world[to] = _world[slot];
+		instance[to] = _instance[slot];
+		dirty[to] = _dirty[slot];
+
+		_node_slot[_slot_node[slot]] = to;
+	}
+
+	_slot_node = std::move(slot_node);
+	_parent_slot = std::move(parent_slot);
+	_local = std::move(local);
+	_world = std::move(world);
+	_instance = std::move(instance);
+	_dirty = std::move(dirty);
+
+	_sorted = true;
+}
+
+uint32_t render::SceneGraph::update(GpuScene& scene)
+{
+	if (!_sorted)
+	{
+		this->sort_by_depth();
+	}
+
+	if (_min_dirty_depth == UINT32_MAX)
+	{
+		return 0;
+	}
+
+	if (_instance_end > scene.instance_count())
+	{
+		throw std::runtime_error(fmt::format("Scene nodes are attached to instance {}, but the GPU scene only has {} uploaded.", _instance_end - 1, scene.instance_count()));
+	}
+
+	GpuInstance* instances = scene.mapped_instances();
+	std::atomic<uint32_t> updated = 0;
+
+	// Levels above the shallowest dirty node have nothing to do. Every level only reads the one before it, which is done.
+	uint32_t levels = static_cast<uint32_t>(_level_starts.size() - 1);
+	for (uint32_t depth = _min_dirty_depth; depth < levels; depth++)
+	{
+		uint32_t level_start = _level_starts[depth];
+		uint32_t level_size = _level_starts[depth + 1] - level_start;
+
+		core::parallel_for(level_size, UPDATE_GRAIN, [&](uint32_t begin, uint32_t end) {
+			uint32_t range_updated = 0;
+
+			for (uint32_t slot = level_start + begin; slot < level_start + end; slot++)
+			{
+				uint32_t parent = _parent_slot[slot];
+				if (parent != NO_SLOT && _dirty[parent])
+				{
+					_dirty[slot] = 1;
+				}
+
+				if (!_dirty[slot])
+				{
+					continue;
+				}
+
+				if (parent == NO_SLOT)
+				{
+					_world[slot] = _local[slot];
+				}
+				else
+				{
+					multiply_transforms(_world[parent], _local[slot], _world[slot]);
+				}
+
+				if (_instance[slot] != NO_INSTANCE)
+				{
+					multiply_transforms(_world[slot], scene.unpack_transform(_instance[slot]), instances[_instance[slot]].transform);
+				}
+
+				range_updated++;
+			}
+
+			updated += range_updated;
+		});
+	}
+
+	std::fill(_dirty.begin() + _level_starts[_min_dirty_depth], _dirty.end(), 0);
+	_min_dirty_depth = UINT32_MAX;
+
+	scene.flush_instances();
+
+	return updated;
+}
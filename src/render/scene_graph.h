@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "render/gpu_scene.h"
+
+namespace render {
+
+	using NodeId = uint32_t;
+	const NodeId NO_NODE = UINT32_MAX;
+
+	// A transform hierarchy kept as flat arrays sorted by depth, so every parent is updated before its children and each
+	// depth level can be spread over every core without locking.
+	// Changing a node marks it dirty, and update only recomputes dirty nodes and whatever is under them. World
+	// transforms of nodes with an instance attached go straight into the GPU scene's instance buffer.
+	class SceneGraph {
+	public:
+		// The parent has to exist already.
+		NodeId add_node(const glm::mat4& local, NodeId parent = NO_NODE);
+		// The node's world transform is written into the instance whenever it changes, with the mesh's unpacking folded in.
+		void attach_instance(NodeId node, InstanceId instance);
+
+		void set_local(NodeId node, const glm::mat4& local);
+		const glm::mat4& local(NodeId node) { return _local[_node_slot[node]]; }
+		// As of the last update.
+		const glm::mat4& world(NodeId node) { return _world[_node_slot[node]]; }
+
+		uint32_t size() { return static_cast<uint32_t>(_node_slot.size()); }
+
+		// Recomputes world transforms a depth level at a time and writes them into the scene's mapped instances, so this
+		// has the same restrictions as GpuScene::mapped_instances. Returns how many nodes were updated.
+		uint32_t update(GpuScene& scene);
+
+	private:
+		void sort_by_depth();
+
+		// Indexed by NodeId. Ids stay the same when nodes are moved around.
+		std::vector<uint32_t> _node_slot;
+		std::vector<uint32_t> _node_depth;
+
+		// Indexed by slot, sorted by depth.
+		std::vector<NodeId> _slot_node;
+		std::vector<uint32_t> _parent_slot;
+		std::vector<glm::mat4> _local;
+		std::vector<glm::mat4> _world;
+		std::vector<InstanceId> _instance;
+		std::vector<uint8_t> _dirty;
+
+		// Where each depth's slots start, plus the end.
+		std::vector<uint32_t> _level_starts;
+		// New nodes go on the end until the next update sorts them in.
+		bool _sorted = true;
+		uint32_t _min_dirty_depth = UINT32_MAX;
+		uint32_t _instance_end = 0;
+	};
+
+}
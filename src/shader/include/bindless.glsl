@@ -0,0 +1,17 @@
+// The bindless heap, see vk::BindlessHeap. Binding numbers have to match src/vk/bindless.h.
+// Indices that aren't dynamically uniform need nonuniformEXT().
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (set = 0, binding = 0) uniform texture2D bindlessTextures[];
+layout (set = 0, binding = 1) uniform sampler bindlessSamplers[];
+
+// Storage buffers (binding 2) and storage images (binding 3) are declared by whoever uses them,
+// since the block layout or image format depends on what's in there:
+//   layout (set = 0, binding = 2) readonly buffer Things { Thing things[]; } thingBuffers[];
+//   layout (set = 0, binding = 3, r32f) uniform image2D depthImages[];
+
+vec4 sample_bindless(uint textureIndex, uint samplerIndex, vec2 uv)
+{
+	return texture(sampler2D(bindlessTextures[nonuniformEXT(textureIndex)], bindlessSamplers[nonuniformEXT(samplerIndex)]), uv);
+}
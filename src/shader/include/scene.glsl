@@ -0,0 +1,65 @@
+// The GPU side of render::GpuScene. Layouts have to match src/render/gpu_scene.h.
+
+#extension GL_EXT_buffer_reference : require
+
+// render::MAX_MESH_LODS.
+#define MAX_MESH_LODS 4
+
+struct GpuMeshLod {
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+	float minScreenSize;
+};
+
+struct GpuMesh {
+	// Bounding sphere in packed space, radius in w. Instance transforms unpack it.
+	vec4 bounds;
+	uint lodCount;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+	GpuMeshLod lods[MAX_MESH_LODS];
+};
+
+struct GpuInstance {
+	mat4 transform;
+	uint mesh;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+};
+
+// VkDrawIndexedIndirectCommand.
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+layout (buffer_reference, std430) readonly buffer MeshBuffer {
+	GpuMesh meshes[];
+};
+
+layout (buffer_reference, std430) readonly buffer InstanceBuffer {
+	GpuInstance instances[];
+};
+
+layout (buffer_reference, std430) writeonly buffer DrawBuffer {
+	DrawCommand draws[];
+};
+
+layout (buffer_reference, std430) buffer CountBuffer {
+	uint drawCount;
+};
+
+// World space bounding sphere of an instance. Scale is taken as the largest axis so non uniform scaling stays conservative.
+vec4 instance_bounds(GpuInstance instance, GpuMesh mesh)
+{
+	vec3 center = (instance.transform * vec4(mesh.bounds.xyz, 1.0f)).xyz;
+	float scale = max(length(instance.transform[0].xyz), max(length(instance.transform[1].xyz), length(instance.transform[2].xyz)));
+
+	return vec4(center, mesh.bounds.w * scale);
+}
@@ -0,0 +1,27 @@
+#version 450
+
+#include "scene.glsl"
+
+layout (location = 0) in vec3 inColor;
+
+layout (location = 0) out vec4 outFragColor;
+
+// render::DrawQueueConstants.
+layout (push_constant) uniform Constants {
+	mat4 viewProj;
+	InstanceBuffer instances;
+	uint material;
+} constants;
+
+// Materials are just a tint for now.
+const vec3 MATERIAL_TINTS[4] = vec3[](
+	vec3(1.0f, 0.6f, 0.2f),
+	vec3(0.3f, 0.8f, 1.0f),
+	vec3(0.9f, 0.2f, 0.5f),
+	vec3(0.6f, 1.0f, 0.3f)
+);
+
+void main()
+{
+	outFragColor = vec4(inColor * MATERIAL_TINTS[constants.material % 4], 1.0f);
+}
@@ -0,0 +1,27 @@
+#version 450
+
+#include "scene.glsl"
+#include "packed_vertex.glsl"
+
+layout (location = 0) out vec3 outColor;
+
+// The depth prepass and the EQUAL tested scene pass both run this, so they have to come up with bit identical depth.
+invariant gl_Position;
+
+layout (push_constant) uniform Constants {
+	mat4 viewProj;
+	InstanceBuffer instances;
+} constants;
+
+void main()
+{
+	// Culling puts the instance index in each draw's firstInstance.
+	GpuInstance instance = constants.instances.instances[gl_InstanceIndex];
+
+	// Transforms have the mesh's unpacking folded in, so positions go in as they were packed.
+	vec3 position = decode_position(vec3(0.0f), vec3(1.0f));
+
+	gl_Position = constants.viewProj * instance.transform * vec4(position, 1.0f);
+	// Nothing has materials yet, normals make for something to look at.
+	outColor = decode_normal() * 0.5f + 0.5f;
+}
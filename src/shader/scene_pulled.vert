@@ -0,0 +1,29 @@
+#version 450
+
+#define PACKED_VERTEX_PULLED
+
+#include "scene.glsl"
+#include "packed_vertex.glsl"
+
+layout (location = 0) out vec3 outColor;
+
+// Same as scene.vert, the prepass and the scene pass have to agree on depth.
+invariant gl_Position;
+
+layout (push_constant) uniform Constants {
+	mat4 viewProj;
+	InstanceBuffer instances;
+	PackedVertexBuffer vertices;
+} constants;
+
+void main()
+{
+	// With the index buffer bound, gl_VertexIndex is already the fetched index plus the draw's vertexOffset.
+	fetch_packed_vertex(constants.vertices, gl_VertexIndex);
+
+	GpuInstance instance = constants.instances.instances[gl_InstanceIndex];
+	vec3 position = decode_position(vec3(0.0f), vec3(1.0f));
+
+	gl_Position = constants.viewProj * instance.transform * vec4(position, 1.0f);
+	outColor = decode_normal() * 0.5f + 0.5f;
+}
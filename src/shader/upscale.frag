@@ -0,0 +1,62 @@
+#version 450
+
+#include "bindless.glsl"
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+// Only the top left drawSize texels of the image were rendered this frame.
+layout (push_constant) uniform Constants {
+	uint drawTexture;
+	uint drawSampler;
+	vec2 drawSize;
+	vec2 invImageSize;
+} constants;
+
+vec4 fetch(vec2 texelPos)
+{
+	// Keep the bilinear footprint inside the rendered region.
+	texelPos = clamp(texelPos, vec2(0.5f), constants.drawSize - 0.5f);
+	vec2 uv = texelPos * constants.invImageSize;
+	return textureLod(sampler2D(bindlessTextures[constants.drawTexture], bindlessSamplers[constants.drawSampler]), uv, 0.0f);
+}
+
+// Catmull-Rom in 9 bilinear taps instead of 16 point ones, by folding the middle two weights on each axis into one tap.
+vec4 sample_catmull_rom(vec2 uv)
+{
+	vec2 samplePos = uv * constants.drawSize;
+	vec2 texPos1 = floor(samplePos - 0.5f) + 0.5f;
+	vec2 f = samplePos - texPos1;
+
+	vec2 w0 = f * (-0.5f + f * (1.0f - 0.5f * f));
+	vec2 w1 = 1.0f + f * f * (-2.5f + 1.5f * f);
+	vec2 w2 = f * (0.5f + f * (2.0f - 1.5f * f));
+	vec2 w3 = f * f * (-0.5f + 0.5f * f);
+
+	vec2 w12 = w1 + w2;
+	vec2 texPos0 = texPos1 - 1.0f;
+	vec2 texPos3 = texPos1 + 2.0f;
+	vec2 texPos12 = texPos1 + w2 / w12;
+
+	vec4 result = vec4(0.0f);
+	result += fetch(vec2(texPos0.x, texPos0.y)) * w0.x * w0.y;
+	result += fetch(vec2(texPos12.x, texPos0.y)) * w12.x * w0.y;
+	result += fetch(vec2(texPos3.x, texPos0.y)) * w3.x * w0.y;
+
+	result += fetch(vec2(texPos0.x, texPos12.y)) * w0.x * w12.y;
+	result += fetch(vec2(texPos12.x, texPos12.y)) * w12.x * w12.y;
+	result += fetch(vec2(texPos3.x, texPos12.y)) * w3.x * w12.y;
+
+	result += fetch(vec2(texPos0.x, texPos3.y)) * w0.x * w3.y;
+	result += fetch(vec2(texPos12.x, texPos3.y)) * w12.x * w3.y;
+	result += fetch(vec2(texPos3.x, texPos3.y)) * w3.x * w3.y;
+
+	// The negative lobes can overshoot below zero around sharp edges.
+	return max(result, vec4(0.0f));
+}
+
+void main() 
+{
+	outFragColor = sample_catmull_rom(inUV);
+}
@@ -0,0 +1,66 @@
+#include "simulation.h"
+
+#include <algorithm>
+
+// Radians per second.
+const float ORBIT_SPEED = 0.1f;
+const float ORBIT_CONTROL_SPEED = 0.8f;
+// Units per second.
+const float ZOOM_SPEED = 20.0f;
+const float MIN_CAMERA_DISTANCE = 5.0f;
+const float MAX_CAMERA_DISTANCE = 200.0f;
+
+void sim::Simulation::step(const Input& input)
+{
+	_previous = _current;
+
+	// Toggles on press rather than while held.
+	if (input.pause && !_pause_held)
+	{
+		_paused = !_paused;
+	}
+	_pause_held = input.pause;
+
+	float dt = static_cast<float>(STEP);
+
+	float orbit = ORBIT_SPEED;
+	if (input.orbit_left)
+	{
+		orbit -= ORBIT_CONTROL_SPEED;
+	}
+	if (input.orbit_right)
+	{
+		orbit += ORBIT_CONTROL_SPEED;
+	}
+	_current.camera_angle += orbit * dt;
+
+	float zoom = 0.0f;
+	if (input.zoom_in)
+	{
+		zoom -= ZOOM_SPEED;
+	}
+	if (input.zoom_out)
+	{
+		zoom += ZOOM_SPEED;
+	}
+	_current.camera_distance = std::clamp(_current.camera_distance + zoom * dt, MIN_CAMERA_DISTANCE, MAX_CAMERA_DISTANCE);
+
+	if (!_paused)
+	{
+		_current.time += STEP;
+	}
+	_current.tick++;
+}
+
+sim::Snapshot sim::Simulation::snapshot(float alpha)
+{
+	auto lerp = [&](float a, float b) { return a + (b - a) * alpha; };
+
+	Snapshot snapshot = _current;
+	snapshot.time = _previous.time + (_current.time - _previous.time) * alpha;
+	snapshot.camera_angle = lerp(_previous.camera_angle, _current.camera_angle);
+	snapshot.camera_distance = lerp(_previous.camera_distance, _current.camera_distance);
+	snapshot.camera_height = lerp(_previous.camera_height, _current.camera_height);
+
+	return snapshot;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+namespace sim {
+
+	// Held keys, sampled on the main thread before each step.
+	struct Input {
+		bool orbit_left = false;
+		bool orbit_right = false;
+		bool zoom_in = false;
+		bool zoom_out = false;
+		bool pause = false;
+	};
+
+	// Everything the renderer needs from the simulation. Plain data, it's copied between threads.
+	struct Snapshot {
+		uint64_t tick = 0;
+		// Simulated seconds that weren't paused, for animation.
+		double time = 0.0;
+
+		// The camera circles the city centre.
+		float camera_angle = 0.0f;
+		float camera_distance = 40.0f;
+		float camera_height = 3.0f;
+	};
+
+	// Advances in fixed steps, however often it's called, so it behaves the same at any frame rate.
+	class Simulation {
+	public:
+		static constexpr double STEP = 1.0 / 120.0;
+
+		void step(const Input& input);
+
+		// Between the last two steps, alpha of the way from the older one.
+		Snapshot snapshot(float alpha);
+
+	private:
+		Snapshot _previous;
+		Snapshot _current;
+
+		bool _paused = false;
+		bool _pause_held = false;
+	};
+
+}
@@ -0,0 +1,33 @@
+// VMA loads its own functions straight from the device, same as our dispatch tables.
+#define VMA_STATIC_VULKAN_FUNCTIONS 0
+#define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
+#define VMA_IMPLEMENTATION
+#include "allocator.h"
+
+#include "context.h"
+#include "device.h"
+#include "vulkan_error.h"
+
+vk::Allocator::Allocator(vk::Context& context, vk::Device& device)
+{
+	VmaVulkanFunctions functions = {};
+	functions.vkGetInstanceProcAddr = vkGetInstanceProcAddr;
+	functions.vkGetDeviceProcAddr = context.dispatch().vkGetDeviceProcAddr;
+
+	VmaAllocatorCreateInfo info = {};
+	info.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+	info.vulkanApiVersion = VK_API_VERSION_1_3;
+	info.instance = context.instance();
+	info.physicalDevice = device.physical_device().get_device();
+	info.device = device.device();
+	info.pAllocationCallbacks = device.allocation_callbacks();
+	info.pVulkanFunctions = &functions;
+
+	auto result = vmaCreateAllocator(&info, &_allocator);
+	vk_check(result);
+}
+
+void vk::Allocator::destroy()
+{
+	vmaDestroyAllocator(_allocator);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+namespace vk {
+
+	class Context;
+	class Device;
+
+	// Device memory allocator. Buffers and images get their memory from here rather than calling vkAllocateMemory themselves.
+	class Allocator {
+	public:
+		Allocator(vk::Context& context, vk::Device& device);
+		void destroy();
+
+		VmaAllocator allocator() { return _allocator; }
+
+	private:
+		VmaAllocator _allocator;
+	};
+
+}
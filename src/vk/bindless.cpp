@@ -0,0 +1,214 @@
+#include "bindless.h"
+
+#include <array>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "buffer.h"
+#include "command_buffer.h"
+#include "device.h"
+#include "vulkan_error.h"
+
+vk::BindlessHeap::BindlessHeap(vk::Device& device) :
+	_device(device),
+	_sampled_images("sampled image", MAX_SAMPLED_IMAGES),
+	_samplers("sampler", MAX_SAMPLERS),
+	_storage_buffers("storage buffer", MAX_STORAGE_BUFFERS),
+	_storage_images("storage image", MAX_STORAGE_IMAGES)
+{
+	const VkShaderStageFlags stages = VK_SHADER_STAGE_ALL;
+
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+	bindings[0] = { SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_SAMPLED_IMAGES, stages, nullptr };
+	bindings[1] = { SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, MAX_SAMPLERS, stages, nullptr };
+	bindings[2] = { STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_STORAGE_BUFFERS, stages, nullptr };
+	bindings[3] = { STORAGE_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_STORAGE_IMAGES, stages, nullptr };
+
+	// Slots can be written while the set is bound, and most of them are empty at any given time.
+	std::array<VkDescriptorBindingFlags, 4> binding_flags;
+	binding_flags.fill(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {};
+	flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flags_info.bindingCount = binding_flags.size();
+	flags_info.pBindingFlags = binding_flags.data();
+
+	VkDescriptorSetLayoutCreateInfo set_layout_info = {};
+	set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set_layout_info.pNext = &flags_info;
+	set_layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	set_layout_info.bindingCount = bindings.size();
+	set_layout_info.pBindings = bindings.data();
+
+	// Through the cache, so pipelines that ask for the same layout get this one and stay compatible with the set.
+	_set_layout = device.objects().descriptor_set_layout(set_layout_info);
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = stages;
+	push_constant_range.offset = 0;
+	push_constant_range.size = PUSH_CONSTANT_SIZE;
+
+	VkPipelineLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layout_info.setLayoutCount = 1;
+	layout_info.pSetLayouts = &_set_layout;
+	layout_info.pushConstantRangeCount = 1;
+	layout_info.pPushConstantRanges = &push_constant_range;
+
+	_layout = device.objects().pipeline_layout(layout_info);
+
+	std::array<VkDescriptorPoolSize, 4> pool_sizes = {};
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		pool_sizes[i] = { bindings[i].descriptorType, bindings[i].descriptorCount };
+	}
+
+	VkDescriptorPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	pool_info.maxSets = 1;
+	pool_info.poolSizeCount = pool_sizes.size();
+	pool_info.pPoolSizes = pool_sizes.data();
+
+	auto result = device.dispatch().vkCreateDescriptorPool(device.device(), &pool_info, device.allocation_callbacks(), &_pool);
+	vk_check(result);
+
+	VkDescriptorSetAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_info.descriptorPool = _pool;
+	alloc_info.descriptorSetCount = 1;
+	alloc_info.pSetLayouts = &_set_layout;
+
+	result = device.dispatch().vkAllocateDescriptorSets(device.device(), &alloc_info, &_set);
+	vk_check(result);
+}
+
+void vk::BindlessHeap::destroy()
+{
+	// The set goes with the pool, the layouts belong to the object cache.
+	_device.dispatch().vkDestroyDescriptorPool(_device.device(), _pool, _device.allocation_callbacks());
+}
+
+void vk::BindlessHeap::bind(vk::CommandBuffer& cmd, VkPipelineBindPoint bind_point)
+{
+	cmd.dispatch().vkCmdBindDescriptorSets(cmd.buffer(), bind_point, _layout, 0, 1, &_set, 0, nullptr);
+}
+
+vk::BindlessIndex vk::BindlessHeap::add_sampled_image(VkImageView view, VkImageLayout layout)
+{
+	std::scoped_lock lock(_mutex);
+
+	BindlessIndex index = _sampled_images.allocate();
+
+	VkDescriptorImageInfo info = {};
+	info.imageView = view;
+	info.imageLayout = layout;
+	this->write(SAMPLED_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &info, nullptr);
+
+	return index;
+}
+
+vk::BindlessIndex vk::BindlessHeap::add_sampler(VkSampler sampler)
+{
+	std::scoped_lock lock(_mutex);
+
+	BindlessIndex index = _samplers.allocate();
+
+	VkDescriptorImageInfo info = {};
+	info.sampler = sampler;
+	this->write(SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, &info, nullptr);
+
+	return index;
+}
+
+vk::BindlessIndex vk::BindlessHeap::add_storage_buffer(vk::Buffer& buffer)
+{
+	std::scoped_lock lock(_mutex);
+
+	BindlessIndex index = _storage_buffers.allocate();
+
+	VkDescriptorBufferInfo info = {};
+	info.buffer = buffer.buffer();
+	info.offset = 0;
+	info.range = VK_WHOLE_SIZE;
+	this->write(STORAGE_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &info);
+
+	return index;
+}
+
+vk::BindlessIndex vk::BindlessHeap::add_storage_image(VkImageView view)
+{
+	std::scoped_lock lock(_mutex);
+
+	BindlessIndex index = _storage_images.allocate();
+
+	VkDescriptorImageInfo info = {};
+	info.imageView = view;
+	info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	this->write(STORAGE_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &info, nullptr);
+
+	return index;
+}
+
+// Removed slots keep their stale descriptor. That's fine, partially bound arrays only care about what's actually accessed.
+void vk::BindlessHeap::remove_sampled_image(BindlessIndex index)
+{
+	std::scoped_lock lock(_mutex);
+	_sampled_images.free(index);
+}
+
+void vk::BindlessHeap::remove_sampler(BindlessIndex index)
+{
+	std::scoped_lock lock(_mutex);
+	_samplers.free(index);
+}
+
+void vk::BindlessHeap::remove_storage_buffer(BindlessIndex index)
+{
+	std::scoped_lock lock(_mutex);
+	_storage_buffers.free(index);
+}
+
+void vk::BindlessHeap::remove_storage_image(BindlessIndex index)
+{
+	std::scoped_lock lock(_mutex);
+	_storage_images.free(index);
+}
+
+void vk::BindlessHeap::write(uint32_t binding, BindlessIndex index, VkDescriptorType type, const VkDescriptorImageInfo* image, const VkDescriptorBufferInfo* buffer)
+{
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = _set;
+	write.dstBinding = binding;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pImageInfo = image;
+	write.pBufferInfo = buffer;
+
+	_device.dispatch().vkUpdateDescriptorSets(_device.device(), 1, &write, 0, nullptr);
+}
+
+vk::BindlessIndex vk::BindlessHeap::Slots::allocate()
+{
+	if (!_free.empty())
+	{
+		BindlessIndex index = _free.back();
+		_free.pop_back();
+		return index;
+	}
+
+	if (_next >= _capacity)
+	{
+		throw std::runtime_error(fmt::format("Bindless heap is out of {} slots ({} in use).", _name, _capacity));
+	}
+
+	return _next++;
+}
+
+void vk::BindlessHeap::Slots::free(BindlessIndex index)
+{
+	_free.push_back(index);
+}
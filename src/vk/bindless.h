@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "push_constants.h"
+
+namespace vk {
+
+	class Buffer;
+	class CommandBuffer;
+	class Device;
+
+	// Stable slot in one of the heap's arrays. Shaders get these through push constants or buffers and index the arrays directly.
+	using BindlessIndex = uint32_t;
+
+	// Every resource a shader can see lives in one big update-after-bind descriptor set, and every pipeline shares one layout.
+	// Nothing gets bound per draw, the set is bound once per command buffer.
+	// Binding numbers have to match src/shader/include/bindless.glsl.
+	class BindlessHeap {
+	public:
+		static constexpr uint32_t SAMPLED_IMAGE_BINDING = 0;
+		static constexpr uint32_t SAMPLER_BINDING = 1;
+		static constexpr uint32_t STORAGE_BUFFER_BINDING = 2;
+		static constexpr uint32_t STORAGE_IMAGE_BINDING = 3;
+
+		// Descriptor indexing guarantees at least 500k update-after-bind descriptors per stage, so these are comfortably legal.
+		static constexpr uint32_t MAX_SAMPLED_IMAGES = 16384;
+		static constexpr uint32_t MAX_SAMPLERS = 256;
+		static constexpr uint32_t MAX_STORAGE_BUFFERS = 16384;
+		static constexpr uint32_t MAX_STORAGE_IMAGES = 4096;
+
+		static constexpr uint32_t PUSH_CONSTANT_SIZE = MAX_PUSH_CONSTANT_SIZE;
+
+		BindlessHeap(vk::Device& device);
+		void destroy();
+
+		BindlessHeap& operator=(const BindlessHeap& other) = delete;
+		BindlessHeap(const BindlessHeap& other) = delete;
+
+		VkDescriptorSetLayout set_layout() { return _set_layout; }
+		VkPipelineLayout layout() { return _layout; }
+		VkDescriptorSet set() { return _set; }
+
+		void bind(vk::CommandBuffer& cmd, VkPipelineBindPoint bind_point);
+
+		BindlessIndex add_sampled_image(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		BindlessIndex add_sampler(VkSampler sampler);
+		BindlessIndex add_storage_buffer(vk::Buffer& buffer);
+		BindlessIndex add_storage_image(VkImageView view);
+
+		// The slot gets handed out again straight away, so the GPU must be done with it.
+		void remove_sampled_image(BindlessIndex index);
+		void remove_sampler(BindlessIndex index);
+		void remove_storage_buffer(BindlessIndex index);
+		void remove_storage_image(BindlessIndex index);
+
+	private:
+		// Hands out slots in one array, reusing freed ones first.
+		class Slots {
+		public:
+			Slots(const char* name, uint32_t capacity) : _name(name), _capacity(capacity) {}
+
+			BindlessIndex allocate();
+			void free(BindlessIndex index);
+
+		private:
+			const char* _name;
+			uint32_t _capacity;
+			uint32_t _next = 0;
+			std::vector<BindlessIndex> _free;
+		};
+
+		void write(uint32_t binding, BindlessIndex index, VkDescriptorType type, const VkDescriptorImageInfo* image, const VkDescriptorBufferInfo* buffer);
+
+		vk::Device& _device;
+
+		VkDescriptorSetLayout _set_layout;
+		VkPipelineLayout _layout;
+		VkDescriptorPool _pool;
+		VkDescriptorSet _set;
+
+		std::mutex _mutex;
+		Slots _sampled_images;
+		Slots _samplers;
+		Slots _storage_buffers;
+		Slots _storage_images;
+	};
+
+}
@@ -0,0 +1,145 @@
+#include "buffer.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "command_buffer.h"
+#include "device.h"
+#include "vulkan_error.h"
+
+vk::Buffer::Buffer(vk::Device& device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory) : _device(&device), _size(size)
+{
+	VkBufferCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	info.size = size;
+	info.usage = usage;
+
+	// Only what the uploader writes is shared with the streaming family, see Device::resource_families.
+	auto families = device.resource_families();
+	if (families.size() > 1 && (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) != 0)
+	{
+		info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		info.queueFamilyIndexCount = families.size();
+		info.pQueueFamilyIndices = families.data();
+	}
+	else
+	{
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	VmaAllocationCreateInfo alloc_info = {};
+	switch (memory)
+	{
+	case MemoryUsage::GpuOnly:
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+		break;
+	case MemoryUsage::CpuToGpu:
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+		alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		break;
+	case MemoryUsage::GpuToCpu:
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+		alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		break;
+	}
+
+	VmaAllocationInfo allocation_info;
+	auto result = vmaCreateBuffer(device.allocator().allocator(), &info, &alloc_info, &_buffer, &_allocation, &allocation_info);
+	vk_check(result);
+
+	_mapped = allocation_info.pMappedData;
+
+	if ((usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0)
+	{
+		VkBufferDeviceAddressInfo address_info = {};
+		address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		address_info.buffer = _buffer;
+		_address = device.dispatch().vkGetBufferDeviceAddress(device.device(), &address_info);
+	}
+}
+
+vk::Buffer::~Buffer()
+{
+	this->release();
+}
+
+vk::Buffer::Buffer(Buffer&& other) :
+	_device(other._device),
+	_buffer(std::exchange(other._buffer, VK_NULL_HANDLE)),
+	_allocation(std::exchange(other._allocation, VK_NULL_HANDLE)),
+	_size(other._size),
+	_address(other._address),
+	_mapped(other._mapped)
+{
+}
+
+vk::Buffer& vk::Buffer::operator=(Buffer&& other)
+{
+	if (this != &other)
+	{
+		this->release();
+
+		_device = other._device;
+		_buffer = std::exchange(other._buffer, VK_NULL_HANDLE);
+		_allocation = std::exchange(other._allocation, VK_NULL_HANDLE);
+		_size = other._size;
+		_address = other._address;
+		_mapped = other._mapped;
+	}
+
+	return *this;
+}
+
+void vk::Buffer::release()
+{
+	if (_buffer != VK_NULL_HANDLE)
+	{
+		vmaDestroyBuffer(_device->allocator().allocator(), _buffer, _allocation);
+		_buffer = VK_NULL_HANDLE;
+		_allocation = VK_NULL_HANDLE;
+	}
+}
+
+void vk::Buffer::write(const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	if (_mapped == nullptr)
+	{
+		throw std::runtime_error("Buffer is not host visible.");
+	}
+
+	std::memcpy(static_cast<char*>(_mapped) + offset, data, size);
+
+	this->flush(offset, size);
+}
+
+void vk::Buffer::flush(VkDeviceSize offset, VkDeviceSize size)
+{
+	auto result = vmaFlushAllocation(_device->allocator().allocator(), _allocation, offset, size);
+	vk_check(result);
+}
+
+void vk::buffer_barrier(vk::CommandBuffer& cmd, vk::Buffer& buffer, BufferBarrierState old_state, BufferBarrierState new_state)
+{
+	VkBufferMemoryBarrier2 barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+
+	barrier.srcStageMask = old_state.stage;
+	barrier.srcAccessMask = old_state.access;
+	barrier.dstStageMask = new_state.stage;
+	barrier.dstAccessMask = new_state.access;
+
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer.buffer();
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo dep_info = {};
+	dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+
+	dep_info.bufferMemoryBarrierCount = 1;
+	dep_info.pBufferMemoryBarriers = &barrier;
+
+	cmd.dispatch().vkCmdPipelineBarrier2(cmd.buffer(), &dep_info);
+}
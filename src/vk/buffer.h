@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+namespace vk {
+
+	class CommandBuffer;
+	class Device;
+
+	enum class MemoryUsage {
+		// Device local. Filled with transfers.
+		GpuOnly,
+		// Host visible and persistently mapped, written sequentially by the CPU every so often.
+		CpuToGpu,
+		// Host visible and persistently mapped, for reading results back.
+		GpuToCpu,
+	};
+
+	struct BufferBarrierState {
+		VkPipelineStageFlags2 stage;
+		VkAccessFlags2 access;
+	};
+
+	class Buffer;
+
+	// Buffer counterpart to transition_image, over the whole buffer.
+	void buffer_barrier(vk::CommandBuffer& cmd, vk::Buffer& buffer, BufferBarrierState old_state, BufferBarrierState new_state);
+
+	class Buffer {
+	public:
+		Buffer(vk::Device& device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory);
+		~Buffer();
+
+		Buffer& operator=(const Buffer& other) = delete;
+		Buffer(const Buffer& other) = delete;
+
+		Buffer(Buffer&& other);
+		Buffer& operator=(Buffer&& other);
+
+		VkBuffer buffer() { return _buffer; }
+		VkDeviceSize size() { return _size; }
+
+		// Only valid for buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+		VkDeviceAddress device_address() { return _address; }
+
+		// Null unless the buffer is host visible.
+		void* mapped() { return _mapped; }
+
+		// Copies into a host visible buffer, flushing if the memory isn't coherent.
+		void write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+		// For host visible buffers written through mapped() directly. A no-op on coherent memory.
+		void flush(VkDeviceSize offset, VkDeviceSize size);
+
+	private:
+		void release();
+
+		vk::Device* _device;
+		VkBuffer _buffer = VK_NULL_HANDLE;
+		VmaAllocation _allocation = VK_NULL_HANDLE;
+		VkDeviceSize _size = 0;
+		VkDeviceAddress _address = 0;
+		void* _mapped = nullptr;
+	};
+
+}
@@ -1,8 +1,10 @@
 #include "command_buffer.h"
 
+#include "buffer.h"
+#include "device.h"
 #include "vulkan_error.h"
 
-vk::CommandBuffer::CommandBuffer(VkDevice device, VkCommandPool command_pool) : _device(device)
+vk::CommandBuffer::CommandBuffer(vk::Device& device, VkCommandPool command_pool) : _dispatch(device.dispatch()), _device(device.device())
 {
     VkCommandBufferAllocateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -11,7 +13,7 @@ vk::CommandBuffer::CommandBuffer(VkDevice device, VkCommandPool command_pool) :
     info.commandBufferCount = 1;
     info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-    auto result = vkAllocateCommandBuffers(device, &info, &_buffer);
+    auto result = _dispatch.vkAllocateCommandBuffers(_device, &info, &_buffer);
     vk_check(result);
 }
 
@@ -22,13 +24,13 @@ void vk::CommandBuffer::begin(VkCommandBufferUsageFlags flags)
 
     info.flags = flags;
 
-    auto result = vkBeginCommandBuffer(_buffer, &info);
+    auto result = _dispatch.vkBeginCommandBuffer(_buffer, &info);
     vk_check(result);
 }
 
 void vk::CommandBuffer::end()
 {
-    auto result = vkEndCommandBuffer(_buffer);
+    auto result = _dispatch.vkEndCommandBuffer(_buffer);
     vk_check(result);
 }
 
@@ -41,4 +43,65 @@ VkCommandBufferSubmitInfo vk::CommandBuffer::submit_info()
     info.commandBuffer = _buffer;
 
     return info;
+}
+
+void vk::CommandBuffer::bind_vertex_buffer(uint32_t binding, vk::Buffer& buffer, VkDeviceSize offset)
+{
+    VkBuffer vk_buffer = buffer.buffer();
+    _dispatch.vkCmdBindVertexBuffers(_buffer, binding, 1, &vk_buffer, &offset);
+}
+
+void vk::CommandBuffer::bind_index_buffer(vk::Buffer& buffer, VkIndexType type, VkDeviceSize offset)
+{
+    _dispatch.vkCmdBindIndexBuffer(_buffer, buffer.buffer(), offset, type);
+}
+
+void vk::CommandBuffer::bind_pipeline(const Pipeline& pipeline)
+{
+    _dispatch.vkCmdBindPipeline(_buffer, pipeline.bind_point, pipeline.pipeline);
+}
+
+void vk::CommandBuffer::push_constants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+{
+    _dispatch.vkCmdPushConstants(_buffer, layout, stages, offset, size, data);
+}
+
+void vk::CommandBuffer::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
+{
+    _dispatch.vkCmdDraw(_buffer, vertex_count, instance_count, first_vertex, first_instance);
+}
+
+void vk::CommandBuffer::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+{
+    _dispatch.vkCmdDrawIndexed(_buffer, index_count, instance_count, first_index, vertex_offset, first_instance);
+}
+
+void vk::CommandBuffer::draw_indexed_indirect(vk::Buffer& buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride)
+{
+    _dispatch.vkCmdDrawIndexedIndirect(_buffer, buffer.buffer(), offset, draw_count, stride);
+}
+
+void vk::CommandBuffer::draw_indexed_indirect_count(vk::Buffer& buffer, VkDeviceSize offset, vk::Buffer& count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+    _dispatch.vkCmdDrawIndexedIndirectCount(_buffer, buffer.buffer(), offset, count_buffer.buffer(), count_offset, max_draw_count, stride);
+}
+
+void vk::CommandBuffer::dispatch_compute(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+{
+    _dispatch.vkCmdDispatch(_buffer, group_count_x, group_count_y, group_count_z);
+}
+
+void vk::CommandBuffer::copy_buffer(vk::Buffer& src, vk::Buffer& dst, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size)
+{
+    VkBufferCopy region = {};
+    region.srcOffset = src_offset;
+    region.dstOffset = dst_offset;
+    region.size = size;
+
+    _dispatch.vkCmdCopyBuffer(_buffer, src.buffer(), dst.buffer(), 1, &region);
+}
+
+void vk::CommandBuffer::fill_buffer(vk::Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value)
+{
+    _dispatch.vkCmdFillBuffer(_buffer, buffer.buffer(), offset, size, value);
 }
\ No newline at end of file
@@ -2,20 +2,82 @@
 
 #include <vulkan/vulkan.h>
 
+#include <stdexcept>
+
+#include "dispatch.h"
+#include "frame_allocator.h"
+#include "pipeline_builder.h"
+#include "push_constants.h"
+
 namespace vk {
+	class Device;
+	class Buffer;
+
 	class CommandBuffer {
 	public:
-		CommandBuffer(VkDevice device, VkCommandPool pool);
+		CommandBuffer(vk::Device& device, VkCommandPool pool);
 
 		VkCommandBuffer buffer() { return _buffer; }
+		const DeviceDispatch& dispatch() { return _dispatch; }
 
 		void begin(VkCommandBufferUsageFlags flags);
 		void end();
 
 		VkCommandBufferSubmitInfo submit_info();
 
+		void bind_vertex_buffer(uint32_t binding, vk::Buffer& buffer, VkDeviceSize offset = 0);
+		void bind_index_buffer(vk::Buffer& buffer, VkIndexType type, VkDeviceSize offset = 0);
+		void bind_pipeline(const Pipeline& pipeline);
+		void push_constants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+
+		// Writes the per draw struct the pipeline declared with set_push_constants. Throws if it's a different struct.
+		template <typename T>
+		void push(const Pipeline& pipeline, const T& data)
+		{
+			static_assert(fits_in_push_constants<T>, "Too big for push constants, use the overload that takes a FrameAllocator.");
+			this->check_push(pipeline, push_constant_type<T>(), push_constant_size<T>());
+			this->push_constants(pipeline.layout, VK_SHADER_STAGE_ALL, 0, sizeof(T), &data);
+		}
+
+		// Same, but structs that don't fit go into frame memory and the shader gets their address instead.
+		template <typename T>
+		void push(const Pipeline& pipeline, const T& data, vk::FrameAllocator& frame)
+		{
+			if constexpr (fits_in_push_constants<T>)
+			{
+				this->push(pipeline, data);
+			}
+			else
+			{
+				this->check_push(pipeline, push_constant_type<T>(), push_constant_size<T>());
+				VkDeviceAddress address = frame.push(data);
+				this->push_constants(pipeline.layout, VK_SHADER_STAGE_ALL, 0, sizeof(address), &address);
+			}
+		}
+
+		void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+		void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+		void draw_indexed_indirect(vk::Buffer& buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+		// The number of draws is read from count_buffer on the GPU, clamped to max_draw_count.
+		void draw_indexed_indirect_count(vk::Buffer& buffer, VkDeviceSize offset, vk::Buffer& count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+
+		void dispatch_compute(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z);
+
+		void copy_buffer(vk::Buffer& src, vk::Buffer& dst, VkDeviceSize src_offset, VkDeviceSize dst_offset, VkDeviceSize size);
+		void fill_buffer(vk::Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value);
+
 	private:
+		// Pipelines that only declared a raw range can only be checked by size.
+		void check_push(const Pipeline& pipeline, PushConstantType type, uint32_t size)
+		{
+			if (pipeline.push_constant_size != size || (pipeline.push_constant_type != nullptr && pipeline.push_constant_type != type))
+			{
+				throw std::runtime_error("Pushed struct doesn't match the pipeline's set_push_constants.");
+			}
+		}
+
+		const DeviceDispatch& _dispatch;
 		VkDevice _device;
 		VkCommandBuffer _buffer;
 	};
-}
\ No newline at end of file
+}
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <iterator>
 #include <stdexcept>
 #include <algorithm>
 
@@ -12,11 +15,18 @@
 #include "vulkan_error.h"
 #include "logger.h"
 
-vk::Context::Context(std::string_view app_name, Window &window) : _app_name(app_name)
+vk::Context::Context(std::string_view app_name, Window &window, ContextOptions options) : _app_name(app_name), _options(options)
 {
+    if (this->_options.track_host_allocations)
+    {
+        this->_host_allocator.emplace(this->_options.pool_host_allocations);
+    }
+
     this->create_instance();
     this->create_surface(window);
-    this->_device.emplace(this->select_physical_device());
+    // The device hands out references to itself, so it's built in place rather than moved in.
+    PhysicalDevice physical_device = this->select_physical_device();
+    this->_device.emplace(*this, physical_device, this->_options.queue_priorities);
     this->_swapchain.emplace(*this, window);
 }
 
@@ -24,24 +34,49 @@ vk::Context::~Context()
 {
     if (this->enable_validation_layers)
     {
-        auto debug_messenger_destroy_func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(this->_instance, "vkDestroyDebugUtilsMessengerEXT");
-        if (debug_messenger_destroy_func != nullptr)
+        if (this->_dispatch.vkDestroyDebugUtilsMessengerEXT != nullptr)
         {
-            debug_messenger_destroy_func(this->_instance, this->_debug_messenger, nullptr);
+            this->_dispatch.vkDestroyDebugUtilsMessengerEXT(this->_instance, this->_debug_messenger, this->allocation_callbacks());
         }
         else
         {
             // Oops. Things are already broken if we can't find the destroy function. Let's just log and move on.
-            fmt::println("No debug messenger destroy function found.");
+            log_warning("No debug messenger destroy function found.");
         }
     }
 
     this->_swapchain.value().destroy();
     this->_device.value().destroy();
 
-    vkDestroySurfaceKHR(this->_instance, this->_surface, nullptr);
+    this->_dispatch.vkDestroySurfaceKHR(this->_instance, this->_surface, this->allocation_callbacks());
+
+    this->_dispatch.vkDestroyInstance(this->_instance, this->allocation_callbacks());
+
+    // Anything still live at this point is a leak, in us or in the driver.
+    if (this->_host_allocator.has_value())
+    {
+        this->_host_allocator.value().log_stats();
+    }
+}
+
+const VkAllocationCallbacks *vk::Context::allocation_callbacks()
+{
+    if (this->_host_allocator.has_value())
+    {
+        return this->_host_allocator.value().callbacks();
+    }
+
+    return nullptr;
+}
+
+vk::HostAllocator *vk::Context::host_allocator()
+{
+    if (this->_host_allocator.has_value())
+    {
+        return &this->_host_allocator.value();
+    }
 
-    vkDestroyInstance(this->_instance, nullptr);
+    return nullptr;
 }
 
 std::vector<const char *> vk::Context::get_required_extensions()
@@ -130,9 +165,11 @@ void vk::Context::create_instance()
         create_info.ppEnabledLayerNames = validation_layers.data();
     }
 
-    VkResult result = vkCreateInstance(&create_info, nullptr, &this->_instance);
+    VkResult result = vkCreateInstance(&create_info, this->allocation_callbacks(), &this->_instance);
     vk_check(result);
 
+    this->_dispatch.load(this->_instance);
+
     if (this->enable_validation_layers)
     {
         this->create_debug_messenger();
@@ -141,45 +178,152 @@ void vk::Context::create_instance()
 
 void vk::Context::create_surface(Window &window)
 {
-    auto result = glfwCreateWindowSurface(this->_instance, window.get_window(), nullptr, &this->_surface);
+    auto result = glfwCreateWindowSurface(this->_instance, window.get_window(), this->allocation_callbacks(), &this->_surface);
     vk_check(result);
 }
 
-vk::Device vk::Context::select_physical_device()
+std::string to_lower(std::string_view str)
+{
+    std::string lower(str);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+    return lower;
+}
+
+std::string strip_dashes(std::string_view str)
+{
+    std::string stripped;
+    std::copy_if(str.begin(), str.end(), std::back_inserter(stripped), [](char c)
+                 { return c != '-'; });
+    return stripped;
+}
+
+std::optional<VkPhysicalDeviceType> parse_device_type(std::string_view selector)
+{
+    if (selector == "discrete")
+    {
+        return VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+    }
+    if (selector == "integrated")
+    {
+        return VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+    }
+    if (selector == "virtual")
+    {
+        return VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU;
+    }
+    if (selector == "cpu")
+    {
+        return VK_PHYSICAL_DEVICE_TYPE_CPU;
+    }
+
+    return std::nullopt;
+}
+
+bool device_matches(PhysicalDevice &device, uint32_t idx, std::string_view selector)
+{
+    if (std::all_of(selector.begin(), selector.end(), [](unsigned char c)
+                    { return std::isdigit(c); }))
+    {
+        return std::to_string(idx) == selector;
+    }
+
+    auto device_type = parse_device_type(selector);
+    if (device_type.has_value())
+    {
+        return device.get_device_type() == device_type.value();
+    }
+
+    if (strip_dashes(device.get_uuid()) == strip_dashes(selector))
+    {
+        return true;
+    }
+
+    return to_lower(device.get_name()).find(selector) != std::string::npos;
+}
+
+std::optional<std::string> vk::Context::get_device_selector()
+{
+    if (this->_options.device_selector.has_value())
+    {
+        return this->_options.device_selector;
+    }
+
+    const char *env = std::getenv("UGO_VK_DEVICE");
+    if (env != nullptr && std::strlen(env) != 0)
+    {
+        return std::string(env);
+    }
+
+    return std::nullopt;
+}
+
+PhysicalDevice vk::Context::select_physical_device()
 {
     uint32_t num_available;
-    auto result = vkEnumeratePhysicalDevices(this->_instance, &num_available, nullptr);
+    auto result = this->_dispatch.vkEnumeratePhysicalDevices(this->_instance, &num_available, nullptr);
     vk_check(result);
 
     std::vector<VkPhysicalDevice> available(num_available);
-    result = vkEnumeratePhysicalDevices(this->_instance, &num_available, available.data());
+    result = this->_dispatch.vkEnumeratePhysicalDevices(this->_instance, &num_available, available.data());
     vk_check(result);
 
-    std::vector<PhysicalDevice> device_infos;
+    std::optional<std::string> selector = this->get_device_selector();
+    if (selector.has_value())
+    {
+        selector = to_lower(selector.value());
+        log("Device selector: {}", selector.value());
+    }
+
+    std::optional<PhysicalDevice> selected;
+    uint32_t selected_idx = 0;
+    uint64_t selected_score = 0;
+    bool selector_matched = false;
 
-    for (int i = 0; i < num_available; i++)
+    for (uint32_t i = 0; i < num_available; i++)
     {
-        PhysicalDevice device_info(available[i], this->_surface);
+        PhysicalDevice device_info(this->_dispatch, available[i], this->_surface);
+        uint64_t score = device_info.score();
+
+        log("Device {}: {} ({}), score {}", i, device_info.get_name(), device_info.get_uuid(), score);
 
-        log("Device {}: {}", i, device_info.get_name());
-        if (device_info.is_usable())
+        if (selector.has_value())
         {
-            device_infos.push_back(device_info);
+            if (!device_matches(device_info, i, selector.value()))
+            {
+                continue;
+            }
+
+            selector_matched = true;
         }
-        else
+
+        if (!device_info.is_usable())
         {
             log("Rejected device.");
+            continue;
         }
+
+        if (!selected.has_value() || score > selected_score)
+        {
+            selected = device_info;
+            selected_idx = i;
+            selected_score = score;
+        }
+    }
+
+    // If someone asked for a specific device, we don't want to quietly run on something else.
+    if (selector.has_value() && !selector_matched)
+    {
+        throw std::runtime_error(fmt::format("No physical device matches selector {}.", selector.value()));
     }
 
-    if (device_infos.size() == 0)
+    if (!selected.has_value())
     {
         throw std::runtime_error("No usable physical devices found.");
     }
 
-    // Just return the first one for now.
-    log("Selected device {}: {}", 0, device_infos[0].get_name());
-    return vk::Device(*this, device_infos[0]);
+    log("Selected device {}: {}", selected_idx, selected.value().get_name());
+    return selected.value();
 }
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -188,8 +332,21 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
     void *pUserData)
 {
+    LogLevel level = LogLevel::Verbose;
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        level = LogLevel::Error;
+    }
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        level = LogLevel::Warning;
+    }
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+    {
+        level = LogLevel::Debug;
+    }
 
-    fmt::println("Validation layer message: {}", pCallbackData->pMessage);
+    Logger::get().log(level, "Validation layer message: {}", pCallbackData->pMessage);
 
     return VK_FALSE;
 }
@@ -199,16 +356,20 @@ void vk::Context::create_debug_messenger()
     VkDebugUtilsMessengerCreateInfoEXT info = {};
 
     info.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    // Don't even ask for verbose messages if they're going to be compiled out.
+    if constexpr (COMPILED_LOG_LEVEL <= LogLevel::Verbose)
+    {
+        info.messageSeverity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    }
     info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
     info.pfnUserCallback = debugCallback;
 
-    auto create_func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(this->_instance, "vkCreateDebugUtilsMessengerEXT");
-    if (create_func == nullptr)
+    if (this->_dispatch.vkCreateDebugUtilsMessengerEXT == nullptr)
     {
         throw std::runtime_error("Debug messenger create function not found.");
     }
 
-    VkResult result = create_func(this->_instance, &info, nullptr, &this->_debug_messenger);
+    VkResult result = this->_dispatch.vkCreateDebugUtilsMessengerEXT(this->_instance, &info, this->allocation_callbacks(), &this->_debug_messenger);
     vk_check(result);
 }
\ No newline at end of file
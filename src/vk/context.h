@@ -7,20 +7,44 @@
 #include <optional>
 
 #include "device.h"
+#include "dispatch.h"
+#include "host_allocator.h"
 #include "swapchain.h"
 
 class Window;
 
 namespace vk {
 
+    struct ContextOptions {
+        // Forces a particular physical device instead of the highest scoring one. Matches a device index,
+        // a device UUID, a device type (discrete, integrated, virtual, cpu) or part of the device name.
+        // Falls back to the UGO_VK_DEVICE environment variable if not set.
+        std::optional<std::string> device_selector;
+
+        // Route driver host allocations through our own callbacks so we can see them.
+        bool track_host_allocations = true;
+        // Serve small command and object scope allocations from pools instead of malloc. Needs tracking on.
+        bool pool_host_allocations = true;
+
+        // How the driver should weigh the frame queue against the streaming queue, when they're separate queues.
+        QueuePriorities queue_priorities;
+    };
+
     class Context {
     public:
-        Context(std::string_view app_name, Window &window);
+        Context(std::string_view app_name, Window &window, ContextOptions options = {});
         Context(const Context& other) = delete;
         Context& operator=(const Context& other) = delete;
 
         ~Context();
 
+        VkInstance instance() { return this->_instance; }
+        const InstanceDispatch& dispatch() { return this->_dispatch; }
+
+        // Null when host allocation tracking is off, which is what Vulkan expects for the default allocator.
+        const VkAllocationCallbacks* allocation_callbacks();
+        HostAllocator* host_allocator();
+
         vk::Device& device() { return _device.value(); }
         VkDevice vk_device() { return _device.value().device(); }
         PhysicalDevice& physical_device() { return _device.value().physical_device(); }
@@ -37,7 +61,8 @@ namespace vk {
 
         void create_surface(Window &window);
 
-        vk::Device select_physical_device();
+        std::optional<std::string> get_device_selector();
+        PhysicalDevice select_physical_device();
 
         void create_debug_messenger();
 
@@ -47,7 +72,11 @@ namespace vk {
         const bool enable_validation_layers = true;
     #endif
 
+        // Declared first so it outlives everything allocated through it.
+        std::optional<HostAllocator> _host_allocator;
+
         VkInstance _instance;
+        InstanceDispatch _dispatch;
         VkDebugUtilsMessengerEXT _debug_messenger;
 
         VkSurfaceKHR _surface;
@@ -56,6 +85,7 @@ namespace vk {
         std::optional<vk::Device> _device;
 
         std::string _app_name;
+        ContextOptions _options;
     };
 
 }
@@ -0,0 +1,111 @@
+#include "deletion_queue.h"
+
+#include <memory>
+#include <vector>
+
+#include "buffer.h"
+#include "device.h"
+#include "image.h"
+
+vk::DeletionQueue::DeletionQueue(vk::Device& device) : _device(device)
+{
+	_timeline.emplace(device);
+}
+
+void vk::DeletionQueue::destroy()
+{
+	this->flush(UINT64_MAX);
+	_timeline.reset();
+}
+
+VkSemaphoreSubmitInfo vk::DeletionQueue::signal_info(VkPipelineStageFlags2 stages)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _timeline->submit_info(stages, _pending);
+}
+
+void vk::DeletionQueue::submitted()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pending++;
+}
+
+void vk::DeletionQueue::retire(vk::Buffer&& buffer)
+{
+	// std::function has to be copyable, so the buffer is kept alive by the pointer instead.
+	auto owned = std::make_shared<vk::Buffer>(std::move(buffer));
+	this->retire([owned]() mutable { owned.reset(); });
+}
+
+void vk::DeletionQueue::retire(vk::Image&& image)
+{
+	auto owned = std::make_shared<vk::Image>(std::move(image));
+	this->retire([owned]() mutable { owned.reset(); });
+}
+
+void vk::DeletionQueue::retire(VkCommandPool pool)
+{
+	vk::Device& device = _device;
+	this->retire([&device, pool]() { device.dispatch().vkDestroyCommandPool(device.device(), pool, device.allocation_callbacks()); });
+}
+
+void vk::DeletionQueue::retire(std::function<void()> destroy)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.push_back({ _pending, std::move(destroy) });
+}
+
+uint32_t vk::DeletionQueue::collect()
+{
+	uint64_t completed = _timeline->completed();
+
+	// Destroyed outside the lock, so destroying something can retire something else.
+	std::vector<Entry> batch;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		while (!_entries.empty() && _entries.front().value <= completed)
+		{
+			batch.push_back(std::move(_entries.front()));
+			_entries.pop_front();
+		}
+	}
+
+	for (Entry& entry : batch)
+	{
+		entry.destroy();
+	}
+
+	return static_cast<uint32_t>(batch.size());
+}
+
+void vk::DeletionQueue::flush(uint64_t timeout_ns)
+{
+	uint64_t last_submitted;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		last_submitted = _pending - 1;
+	}
+
+	if (last_submitted != 0)
+	{
+		_timeline->wait(last_submitted, timeout_ns);
+	}
+
+	// Anything tagged with the pending value was only ever used by work that didn't get submitted.
+	std::deque<Entry> entries;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		entries.swap(_entries);
+	}
+
+	for (Entry& entry : entries)
+	{
+		entry.destroy();
+	}
+}
+
+size_t vk::DeletionQueue::size()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+#include "sync.h"
+
+namespace vk {
+
+	class Buffer;
+	class Device;
+	class Image;
+
+	// Destroys resources once the GPU is done with them, so replacing one never has to wait for the device to go idle.
+	// Frame submits signal the queue's timeline with signal_info, and everything retired in the meantime is tagged with
+	// the value that submit signals. collect then destroys whatever the GPU has got past, all in one go, without waiting.
+	// Only submits that signal the timeline are covered, so work on other queues has to be waited on by whoever submits it.
+	// Owned by the device. Anything still queued when the device is destroyed goes after waiting for the last submit.
+	class DeletionQueue {
+	public:
+		DeletionQueue(vk::Device& device);
+		void destroy();
+
+		DeletionQueue& operator=(const DeletionQueue& other) = delete;
+		DeletionQueue(const DeletionQueue& other) = delete;
+
+		// For the next frame submit to signal. Call submitted once it's been submitted.
+		VkSemaphoreSubmitInfo signal_info(VkPipelineStageFlags2 stages);
+		void submitted();
+
+		// Safe from any thread. Whatever's retired can't be used by anything recorded afterwards.
+		void retire(vk::Buffer&& buffer);
+		void retire(vk::Image&& image);
+		void retire(VkCommandPool pool);
+		void retire(std::function<void()> destroy);
+
+		// Destroys everything the GPU has finished with. Returns how many were destroyed.
+		uint32_t collect();
+		// Waits for the last submit, then destroys everything, including what's been retired since. For shutting down.
+		void flush(uint64_t timeout_ns);
+
+		size_t size();
+
+	private:
+		struct Entry {
+			uint64_t value;
+			std::function<void()> destroy;
+		};
+
+		vk::Device& _device;
+		std::optional<vk::TimelineSemaphore> _timeline;
+
+		std::mutex _mutex;
+		// Values only go up, so the front is always the next to go.
+		std::deque<Entry> _entries;
+		// What the next submit signals. The timeline starts at 0, so nothing's been submitted while this is 1.
+		uint64_t _pending = 1;
+	};
+
+}
@@ -7,20 +7,66 @@
 
 #include <fmt/format.h>
 
+#include "context.h"
 #include "vulkan_error.h"
 #include "logger.h"
 
-vk::Device::Device(vk::Context &context, PhysicalDevice &device_info) : _context(context), _physical_device(device_info)
+vk::Device::Device(vk::Context &context, PhysicalDevice &device_info, QueuePriorities priorities) : _context(context), _physical_device(device_info), _priorities(priorities)
 {
+	// Vulkan only takes priorities between 0 and 1.
+	if (!(priorities.frame >= 0.0f && priorities.frame <= 1.0f) || !(priorities.streaming >= 0.0f && priorities.streaming <= 1.0f))
+	{
+		throw std::runtime_error(fmt::format("Queue priorities have to be between 0 and 1, got {} for the frame and {} for streaming.", priorities.frame, priorities.streaming));
+	}
+
 	this->create_logical_device();
+	this->assign_queue_roles();
+
+	this->_allocator.emplace(context, *this);
+	this->_samplers.emplace(*this);
+	this->_objects.emplace(*this);
+	this->_bindless.emplace(*this);
+	this->_deletion_queue.emplace(*this);
+	this->_resources.emplace(*this);
 }
 
 void vk::Device::destroy()
 {
-	vkDestroyDevice(this->_device, nullptr);
+	// Pooled resources go through the deletion queue, and retired buffers and images still have allocations.
+	this->_resources.value().destroy();
+	this->_deletion_queue.value().destroy();
+	this->_bindless.value().destroy();
+	this->_objects.value().destroy();
+	this->_samplers.value().destroy();
+	this->_allocator.value().destroy();
+	this->_dispatch.vkDestroyDevice(this->_device, this->allocation_callbacks());
+}
+
+const VkAllocationCallbacks* vk::Device::allocation_callbacks()
+{
+	return this->_context.allocation_callbacks();
+}
+
+VkFormatFeatureFlags2 vk::Device::format_features(VkFormat format)
+{
+	VkFormatProperties3 properties3 = {};
+	properties3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+	VkFormatProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+	properties.pNext = &properties3;
+
+	this->_context.dispatch().vkGetPhysicalDeviceFormatProperties2(this->_physical_device.get_device(), format, &properties);
+
+	return properties3.optimalTilingFeatures;
+}
+
+float vk::Device::max_anisotropy()
+{
+	return this->_physical_device.get_limits().maxSamplerAnisotropy;
 }
 
-VkCommandPool alloc_command_pool(VkDevice device, uint32_t queue_index, VkCommandPoolCreateFlags flags)
+VkCommandPool alloc_command_pool(vk::Device& device, uint32_t queue_index, VkCommandPoolCreateFlags flags)
 {
 	VkCommandPoolCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -29,7 +75,7 @@ VkCommandPool alloc_command_pool(VkDevice device, uint32_t queue_index, VkComman
 	info.flags = flags;
 
 	VkCommandPool pool;
-	auto result = vkCreateCommandPool(device, &info, nullptr, &pool);
+	auto result = device.dispatch().vkCreateCommandPool(device.device(), &info, device.allocation_callbacks(), &pool);
 	vk_check(result);
 
 	return pool;
@@ -37,12 +83,56 @@ VkCommandPool alloc_command_pool(VkDevice device, uint32_t queue_index, VkComman
 
 VkCommandPool vk::Device::alloc_graphics_pool(VkCommandPoolCreateFlags flags)
 {
-	return alloc_command_pool(this->_device, this->graphics_family(), flags);
+	return alloc_command_pool(*this, this->graphics_family(), flags);
 }
 
 VkCommandPool vk::Device::alloc_transfer_pool(VkCommandPoolCreateFlags flags)
 {
-	return alloc_command_pool(this->_device, this->transfer_family(), flags);
+	return alloc_command_pool(*this, this->transfer_family(), flags);
+}
+
+VkQueue vk::Device::queue(QueueRole role)
+{
+	QueueSlot slot = this->_queue_roles.at(static_cast<size_t>(role));
+	return this->get_queue(slot.family, slot.index);
+}
+
+uint32_t vk::Device::queue_family(QueueRole role)
+{
+	return this->_queue_roles.at(static_cast<size_t>(role)).family;
+}
+
+std::vector<uint32_t> vk::Device::resource_families()
+{
+	std::vector<uint32_t> families = { this->queue_family(QueueRole::Frame) };
+	if (this->queue_family(QueueRole::Streaming) != families[0])
+	{
+		families.push_back(this->queue_family(QueueRole::Streaming));
+	}
+
+	return families;
+}
+
+uint32_t vk::Device::queue_count(uint32_t family)
+{
+	return this->get_queue_family(family).queues.size();
+}
+
+VkQueue vk::Device::get_queue(uint32_t family, uint32_t index)
+{
+	return this->get_queue_family(family).queues.at(index);
+}
+
+vk::Device::QueueFamily& vk::Device::get_queue_family(uint32_t family)
+{
+	auto result = std::find_if(this->_queue_families.begin(), this->_queue_families.end(), [family](QueueFamily& f)
+							   { return f.index == family; });
+	if (result == this->_queue_families.end())
+	{
+		throw std::runtime_error(fmt::format("Queue family {} was not created.", family));
+	}
+
+	return *result;
 }
 
 void vk::Device::create_logical_device()
@@ -50,9 +140,15 @@ void vk::Device::create_logical_device()
 	VkDeviceCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-	// We don't really care about features for now.
+	// Only turn on what we use, and only if it's there.
 	VkPhysicalDeviceFeatures2 device_features = {};
 	device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	// Lets one indirect call issue many draws. This and the other GPU driven drawing features are checked by PhysicalDevice::is_usable.
+	device_features.features.multiDrawIndirect = VK_TRUE;
+	// Culling writes each draw's instance index into firstInstance.
+	device_features.features.drawIndirectFirstInstance = VK_TRUE;
+	device_features.features.samplerAnisotropy = this->_physical_device.get_features().samplerAnisotropy;
+	this->_anisotropy_enabled = device_features.features.samplerAnisotropy == VK_TRUE;
 	info.pEnabledFeatures = &device_features.features;
 
 	// Dynamic rendering is hidden behind it's own feature flag struct.
@@ -67,6 +163,27 @@ void vk::Device::create_logical_device()
 	sync_features.synchronization2 = VK_TRUE;
 	dynamic_rendering_features.pNext = &sync_features;
 
+	// Everything that was promoted in 1.2 lives in one struct.
+	VkPhysicalDeviceVulkan12Features features12 = {};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	// Needed to pull vertices straight out of buffers. Required by 1.3, so no need to check.
+	features12.bufferDeviceAddress = VK_TRUE;
+	// Descriptor indexing for the bindless heap. PhysicalDevice::is_usable checks for these.
+	features12.runtimeDescriptorArray = VK_TRUE;
+	features12.descriptorBindingPartiallyBound = VK_TRUE;
+	features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features12.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+	features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	features12.shaderStorageImageArrayNonUniformIndexing = this->_physical_device.get_features12().shaderStorageImageArrayNonUniformIndexing;
+	// Culling on the GPU decides how many draws there are.
+	features12.drawIndirectCount = VK_TRUE;
+	// Resources are destroyed once a timeline value says the GPU is past them. Required by 1.2, so no need to check.
+	features12.timelineSemaphore = VK_TRUE;
+	sync_features.pNext = &features12;
+
 	info.enabledExtensionCount = PhysicalDevice::REQUIRED_DEVICE_EXTENSIONS.size();
 	info.ppEnabledExtensionNames = PhysicalDevice::REQUIRED_DEVICE_EXTENSIONS.data();
 
@@ -94,16 +211,32 @@ void vk::Device::create_logical_device()
 	// Queue families may overlap so use a set to distinguish them.
 	std::unordered_set<uint32_t> required_queues = {this->_graphics_family, this->_transfer_family, this->_present_family};
 
+	// Ask for every queue each family has. The first queue of the graphics and present families carries the frame,
+	// so it gets the frame priority. Everything else is background work.
+	for (auto idx : required_queues)
+	{
+		QueueFamily family = {};
+		family.index = idx;
+
+		uint32_t count = this->_physical_device.get_queue_count(idx);
+		family.priorities.resize(count, this->_priorities.streaming);
+		if (idx == this->_graphics_family || idx == this->_present_family)
+		{
+			family.priorities[0] = this->_priorities.frame;
+		}
+
+		this->_queue_families.push_back(std::move(family));
+	}
+
 	std::vector<VkDeviceQueueCreateInfo> queue_infos;
-	float priority = 1.0f;
 
-	for (auto idx : required_queues)
+	for (auto& family : this->_queue_families)
 	{
 		VkDeviceQueueCreateInfo queue_create_info = {};
 		queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queue_create_info.queueCount = 1;
-		queue_create_info.queueFamilyIndex = idx;
-		queue_create_info.pQueuePriorities = &priority;
+		queue_create_info.queueCount = family.priorities.size();
+		queue_create_info.queueFamilyIndex = family.index;
+		queue_create_info.pQueuePriorities = family.priorities.data();
 
 		queue_infos.push_back(queue_create_info);
 	}
@@ -111,24 +244,48 @@ void vk::Device::create_logical_device()
 	info.queueCreateInfoCount = queue_infos.size();
 	info.pQueueCreateInfos = queue_infos.data();
 
-	VkResult result = vkCreateDevice(this->_physical_device.get_device(), &info, nullptr, &this->_device);
+	auto& instance_dispatch = this->_context.dispatch();
+	VkResult result = instance_dispatch.vkCreateDevice(this->_physical_device.get_device(), &info, this->allocation_callbacks(), &this->_device);
 	vk_check(result);
 
-	VkDeviceQueueInfo2 graphics_queue_info = {};
-	graphics_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_INFO_2;
-	graphics_queue_info.queueFamilyIndex = this->_graphics_family;
-	graphics_queue_info.queueIndex = 0;
-	vkGetDeviceQueue2(this->_device, &graphics_queue_info, &this->_graphics_queue);
-
-	VkDeviceQueueInfo2 present_queue_info = {};
-	present_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_INFO_2;
-	present_queue_info.queueFamilyIndex = this->_present_family;
-	present_queue_info.queueIndex = 0;
-	vkGetDeviceQueue2(this->_device, &present_queue_info, &this->_present_queue);
-
-	VkDeviceQueueInfo2 transfer_queue_info = {};
-	transfer_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_INFO_2;
-	transfer_queue_info.queueFamilyIndex = this->_transfer_family;
-	transfer_queue_info.queueIndex = 0;
-	vkGetDeviceQueue2(this->_device, &transfer_queue_info, &this->_transfer_queue);
+	this->_dispatch.load(this->_device, instance_dispatch.vkGetDeviceProcAddr);
+
+	for (auto& family : this->_queue_families)
+	{
+		family.queues.resize(family.priorities.size());
+		for (uint32_t i = 0; i < family.queues.size(); i++)
+		{
+			VkDeviceQueueInfo2 queue_info = {};
+			queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_INFO_2;
+			queue_info.queueFamilyIndex = family.index;
+			queue_info.queueIndex = i;
+			this->_dispatch.vkGetDeviceQueue2(this->_device, &queue_info, &family.queues[i]);
+		}
+	}
+}
+
+void vk::Device::assign_queue_roles()
+{
+	QueueSlot frame = { this->_graphics_family, 0 };
+
+	// Presenting from the frame queue keeps presentation ordered after the frame's submit.
+	QueueSlot present = { this->_present_family, 0 };
+
+	// Streaming work wants its own queue so it never sits in front of frame work. A dedicated transfer
+	// family is best, then a second graphics queue. As a last resort we share the frame queue.
+	QueueSlot streaming = { this->_transfer_family, 0 };
+	if (this->_transfer_family == this->_graphics_family && this->queue_count(this->_graphics_family) > 1)
+	{
+		streaming.index = 1;
+	}
+
+	this->_queue_roles[static_cast<size_t>(QueueRole::Frame)] = frame;
+	this->_queue_roles[static_cast<size_t>(QueueRole::Present)] = present;
+	this->_queue_roles[static_cast<size_t>(QueueRole::Streaming)] = streaming;
+
+	for (auto& family : this->_queue_families)
+	{
+		log("Queue family {}: {} queues", family.index, family.queues.size());
+	}
+	log("Streaming queue: family {}, index {}", streaming.family, streaming.index);
 }
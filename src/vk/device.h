@@ -2,48 +2,120 @@
 
 #include "vulkan/vulkan.h"
 
+#include <array>
 #include <vector>
 #include <optional>
 
+#include "allocator.h"
+#include "bindless.h"
+#include "deletion_queue.h"
+#include "dispatch.h"
+#include "object_cache.h"
 #include "physical_device.h"
+#include "resource_pools.h"
+#include "sampler_cache.h"
 
 
 namespace vk {
     class Context;
 
+    // Subsystems ask for a queue by what they're going to use it for, rather than by family.
+    // Roles may end up sharing a hardware queue if the device doesn't have enough of them.
+    enum class QueueRole {
+        // Latency critical work, i.e. everything that goes into the current frame.
+        Frame,
+        // Presentation. Shares the frame queue whenever the families allow it.
+        Present,
+        // Uploads and other background work that shouldn't hold up the frame.
+        Streaming,
+
+        Count,
+    };
+
+    struct QueuePriorities {
+        float frame = 1.0f;
+        float streaming = 0.25f;
+    };
+
     class Device {
     public:
-        Device(vk::Context &context, PhysicalDevice &device_info);
+        Device(vk::Context &context, PhysicalDevice &device_info, QueuePriorities priorities = {});
         void destroy();
 
         PhysicalDevice &physical_device() { return this->_physical_device; }
         VkDevice device() { return this->_device; }
+        const DeviceDispatch& dispatch() { return this->_dispatch; }
+        const VkAllocationCallbacks* allocation_callbacks();
+        vk::Allocator& allocator() { return this->_allocator.value(); }
+        vk::SamplerCache& samplers() { return this->_samplers.value(); }
+        vk::ObjectCache& objects() { return this->_objects.value(); }
+        vk::BindlessHeap& bindless() { return this->_bindless.value(); }
+        vk::DeletionQueue& deletion_queue() { return this->_deletion_queue.value(); }
+        vk::ResourcePools& resources() { return this->_resources.value(); }
+
+        VkFormatFeatureFlags2 format_features(VkFormat format);
+
+        bool anisotropy_enabled() { return this->_anisotropy_enabled; }
+        float max_anisotropy();
 
         uint32_t graphics_family() { return this->_graphics_family; }
         uint32_t transfer_family() { return this->_transfer_family; }
         uint32_t present_family() { return this->_present_family; }
 
-        VkQueue graphics_queue() { return this->_graphics_queue; }
-        VkQueue transfer_queue() { return this->_transfer_queue; }
-        VkQueue present_queue() { return this->_present_queue; }
+        VkQueue graphics_queue() { return this->queue(QueueRole::Frame); }
+        VkQueue transfer_queue() { return this->queue(QueueRole::Streaming); }
+        VkQueue present_queue() { return this->queue(QueueRole::Present); }
+
+        VkQueue queue(QueueRole role);
+        uint32_t queue_family(QueueRole role);
+
+        // Families that touch buffers and images: the frame family, plus the streaming family if it's a different one.
+        // Resources the uploader writes, i.e. with transfer dst usage, are shared concurrently between these, so uploads
+        // don't need ownership transfers. Everything else stays exclusive, which keeps attachment compression on.
+        std::vector<uint32_t> resource_families();
+
+        // Every queue the device offers is created, so subsystems can also grab extra ones directly.
+        uint32_t queue_count(uint32_t family);
+        VkQueue get_queue(uint32_t family, uint32_t index);
 
         VkCommandPool alloc_graphics_pool(VkCommandPoolCreateFlags flags);
         VkCommandPool alloc_transfer_pool(VkCommandPoolCreateFlags flags);
 
     private:
+        struct QueueFamily {
+            uint32_t index;
+            std::vector<float> priorities;
+            std::vector<VkQueue> queues;
+        };
+
+        struct QueueSlot {
+            uint32_t family;
+            uint32_t index;
+        };
+
         void create_logical_device();
+        void assign_queue_roles();
+
+        QueueFamily& get_queue_family(uint32_t family);
 
         vk::Context& _context;
         VkDevice _device;
+        DeviceDispatch _dispatch;
+        std::optional<vk::Allocator> _allocator;
+        std::optional<vk::SamplerCache> _samplers;
+        std::optional<vk::ObjectCache> _objects;
+        std::optional<vk::BindlessHeap> _bindless;
+        std::optional<vk::DeletionQueue> _deletion_queue;
+        std::optional<vk::ResourcePools> _resources;
         PhysicalDevice _physical_device;
+        QueuePriorities _priorities;
+        bool _anisotropy_enabled = false;
 
         uint32_t _graphics_family;
-        VkQueue _graphics_queue;
-
         uint32_t _transfer_family;
-        VkQueue _transfer_queue;
-
         uint32_t _present_family;
-        VkQueue _present_queue;
+
+        std::vector<QueueFamily> _queue_families;
+        std::array<QueueSlot, static_cast<size_t>(QueueRole::Count)> _queue_roles;
     };
 }
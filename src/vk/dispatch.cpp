@@ -0,0 +1,39 @@
+#include "dispatch.h"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+void require_function(void *func, const char *name)
+{
+	if (func == nullptr)
+	{
+		throw std::runtime_error(fmt::format("Could not load Vulkan function {}.", name));
+	}
+}
+
+void vk::InstanceDispatch::load(VkInstance instance)
+{
+#define UGO_VK_LOAD_FUNCTION(name) \
+	name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name)); \
+	require_function(reinterpret_cast<void *>(name), #name);
+#define UGO_VK_LOAD_OPTIONAL_FUNCTION(name) \
+	name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+
+	UGO_VK_INSTANCE_FUNCTIONS(UGO_VK_LOAD_FUNCTION)
+	UGO_VK_INSTANCE_OPTIONAL_FUNCTIONS(UGO_VK_LOAD_OPTIONAL_FUNCTION)
+
+#undef UGO_VK_LOAD_OPTIONAL_FUNCTION
+#undef UGO_VK_LOAD_FUNCTION
+}
+
+void vk::DeviceDispatch::load(VkDevice device, PFN_vkGetDeviceProcAddr get_device_proc_addr)
+{
+#define UGO_VK_LOAD_FUNCTION(name) \
+	name = reinterpret_cast<PFN_##name>(get_device_proc_addr(device, #name)); \
+	require_function(reinterpret_cast<void *>(name), #name);
+
+	UGO_VK_DEVICE_FUNCTIONS(UGO_VK_LOAD_FUNCTION)
+
+#undef UGO_VK_LOAD_FUNCTION
+}
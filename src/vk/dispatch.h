@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Function tables loaded straight from the driver, so calls skip the loader's trampolines.
+// To call a new function, add it to the relevant list below - the tables and loaders are generated from these.
+
+// Instance level functions. These are resolved with vkGetInstanceProcAddr once the instance exists.
+#define UGO_VK_INSTANCE_FUNCTIONS(X) \
+	X(vkDestroyInstance) \
+	X(vkEnumeratePhysicalDevices) \
+	X(vkGetPhysicalDeviceProperties2) \
+	X(vkGetPhysicalDeviceFeatures2) \
+	X(vkGetPhysicalDeviceMemoryProperties2) \
+	X(vkGetPhysicalDeviceFormatProperties2) \
+	X(vkGetPhysicalDeviceQueueFamilyProperties2) \
+	X(vkEnumerateDeviceExtensionProperties) \
+	X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+	X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+	X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+	X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+	X(vkDestroySurfaceKHR) \
+	X(vkCreateDevice) \
+	X(vkGetDeviceProcAddr)
+
+// Instance level functions from extensions we don't always enable. These may be null.
+#define UGO_VK_INSTANCE_OPTIONAL_FUNCTIONS(X) \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkDestroyDebugUtilsMessengerEXT)
+
+// Device level functions, resolved with vkGetDeviceProcAddr for the device we created.
+#define UGO_VK_DEVICE_FUNCTIONS(X) \
+	X(vkDestroyDevice) \
+	X(vkDeviceWaitIdle) \
+	X(vkGetDeviceQueue2) \
+	X(vkQueueSubmit2) \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkGetSemaphoreCounterValue) \
+	X(vkWaitSemaphores) \
+	X(vkCreateFence) \
+	X(vkDestroyFence) \
+	X(vkWaitForFences) \
+	X(vkResetFences) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkGetImageMemoryRequirements2) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	X(vkCreateSampler) \
+	X(vkDestroySampler) \
+	X(vkCreateDescriptorSetLayout) \
+	X(vkDestroyDescriptorSetLayout) \
+	X(vkCreateDescriptorPool) \
+	X(vkDestroyDescriptorPool) \
+	X(vkAllocateDescriptorSets) \
+	X(vkUpdateDescriptorSets) \
+	X(vkCreateQueryPool) \
+	X(vkDestroyQueryPool) \
+	X(vkGetQueryPoolResults) \
+	X(vkCreateShaderModule) \
+	X(vkDestroyShaderModule) \
+	X(vkCreatePipelineLayout) \
+	X(vkDestroyPipelineLayout) \
+	X(vkCreateGraphicsPipelines) \
+	X(vkCreateComputePipelines) \
+	X(vkDestroyPipeline) \
+	X(vkGetBufferDeviceAddress) \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR) \
+	X(vkCmdPipelineBarrier2) \
+	X(vkCmdBeginRendering) \
+	X(vkCmdEndRendering) \
+	X(vkCmdBindPipeline) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdBindVertexBuffers) \
+	X(vkCmdBindIndexBuffer) \
+	X(vkCmdBindDescriptorSets) \
+	X(vkCmdPushConstants) \
+	X(vkCmdDraw) \
+	X(vkCmdDrawIndexed) \
+	X(vkCmdDrawIndexedIndirect) \
+	X(vkCmdDrawIndexedIndirectCount) \
+	X(vkCmdDispatch) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdCopyBuffer) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdWriteTimestamp2) \
+	X(vkCmdCopyBufferToImage2) \
+	X(vkCmdBlitImage2)
+
+#define UGO_VK_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+
+namespace vk {
+
+	struct InstanceDispatch {
+		UGO_VK_INSTANCE_FUNCTIONS(UGO_VK_DECLARE_FUNCTION)
+		UGO_VK_INSTANCE_OPTIONAL_FUNCTIONS(UGO_VK_DECLARE_FUNCTION)
+
+		void load(VkInstance instance);
+	};
+
+	struct DeviceDispatch {
+		UGO_VK_DEVICE_FUNCTIONS(UGO_VK_DECLARE_FUNCTION)
+
+		void load(VkDevice device, PFN_vkGetDeviceProcAddr get_device_proc_addr);
+	};
+
+}
+
+#undef UGO_VK_DECLARE_FUNCTION
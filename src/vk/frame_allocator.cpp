@@ -0,0 +1,51 @@
+#include "frame_allocator.h"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "device.h"
+
+vk::FrameAllocator::FrameAllocator(vk::Device& device, uint32_t frames_in_flight, VkDeviceSize frame_size) :
+	_buffer(device, frame_size * frames_in_flight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, vk::MemoryUsage::CpuToGpu),
+	_frame_size(frame_size),
+	_frames_in_flight(frames_in_flight)
+{
+}
+
+void vk::FrameAllocator::begin_frame(uint32_t frame)
+{
+	_frame_start = (frame % _frames_in_flight) * _frame_size;
+	_used = 0;
+	_flushed = 0;
+}
+
+vk::FrameAllocator::Allocation vk::FrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset = (_used + alignment - 1) & ~(alignment - 1);
+	if (offset + size > _frame_size)
+	{
+		throw std::runtime_error(fmt::format("Frame allocator is out of space ({} of {} bytes used, {} requested).", _used, _frame_size, size));
+	}
+
+	_used = offset + size;
+
+	VkDeviceSize buffer_offset = _frame_start + offset;
+
+	Allocation allocation = {};
+	allocation.data = static_cast<char*>(_buffer.mapped()) + buffer_offset;
+	allocation.address = _buffer.device_address() + buffer_offset;
+	allocation.buffer = _buffer.buffer();
+	allocation.offset = buffer_offset;
+
+	return allocation;
+}
+
+void vk::FrameAllocator::flush()
+{
+	if (_used > _flushed)
+	{
+		_buffer.flush(_frame_start + _flushed, _used - _flushed);
+		_flushed = _used;
+	}
+}
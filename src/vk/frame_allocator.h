@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <vector>
+
+#include "buffer.h"
+
+namespace vk {
+
+	class Device;
+
+	// Scratch GPU memory that only has to live for one frame. Allocation is a pointer bump into a persistently mapped buffer,
+	// and the whole frame's worth is thrown away at once by begin_frame.
+	// Each frame in flight gets its own region, so the CPU never writes over something the GPU is still reading.
+	class FrameAllocator {
+	public:
+		static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+		struct Allocation {
+			void* data;
+			VkDeviceAddress address;
+			VkBuffer buffer;
+			VkDeviceSize offset;
+		};
+
+		FrameAllocator(vk::Device& device, uint32_t frames_in_flight, VkDeviceSize frame_size = DEFAULT_FRAME_SIZE);
+
+		FrameAllocator& operator=(const FrameAllocator& other) = delete;
+		FrameAllocator(const FrameAllocator& other) = delete;
+
+		// Only call once the GPU is done with whatever this frame slot was last used for.
+		void begin_frame(uint32_t frame);
+
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+		template <typename T>
+		VkDeviceAddress push(const T& value)
+		{
+			Allocation allocation = this->allocate(sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+			std::memcpy(allocation.data, &value, sizeof(T));
+			return allocation.address;
+		}
+
+		// Makes this frame's writes visible to the device. Call before submitting.
+		void flush();
+
+		vk::Buffer& buffer() { return _buffer; }
+
+	private:
+		vk::Buffer _buffer;
+		VkDeviceSize _frame_size;
+		uint32_t _frames_in_flight;
+
+		VkDeviceSize _frame_start = 0;
+		VkDeviceSize _used = 0;
+		VkDeviceSize _flushed = 0;
+	};
+
+}
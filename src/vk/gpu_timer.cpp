@@ -0,0 +1,84 @@
+#include "gpu_timer.h"
+
+#include "command_buffer.h"
+#include "device.h"
+#include "vulkan_error.h"
+
+vk::GpuTimer::GpuTimer(vk::Device& device, uint32_t frames_in_flight) :
+	_device(device),
+	_frames_in_flight(frames_in_flight),
+	_pending(frames_in_flight, false)
+{
+	VkPhysicalDeviceLimits& limits = device.physical_device().get_limits();
+	uint32_t valid_bits = device.physical_device().get_timestamp_valid_bits(device.graphics_family());
+	_supported = limits.timestampComputeAndGraphics && limits.timestampPeriod > 0.0f && valid_bits > 0;
+	_ns_per_tick = limits.timestampPeriod;
+	_timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+	if (!_supported)
+	{
+		return;
+	}
+
+	VkQueryPoolCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	info.queryCount = frames_in_flight * 2;
+
+	auto result = device.dispatch().vkCreateQueryPool(device.device(), &info, device.allocation_callbacks(), &_pool);
+	vk_check(result);
+}
+
+vk::GpuTimer::~GpuTimer()
+{
+	if (_pool != VK_NULL_HANDLE)
+	{
+		_device.dispatch().vkDestroyQueryPool(_device.device(), _pool, _device.allocation_callbacks());
+	}
+}
+
+void vk::GpuTimer::begin(vk::CommandBuffer& cmd, uint32_t frame)
+{
+	if (!_supported)
+	{
+		return;
+	}
+
+	uint32_t first = (frame % _frames_in_flight) * 2;
+	cmd.dispatch().vkCmdResetQueryPool(cmd.buffer(), _pool, first, 2);
+	cmd.dispatch().vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, _pool, first);
+}
+
+void vk::GpuTimer::end(vk::CommandBuffer& cmd, uint32_t frame)
+{
+	if (!_supported)
+	{
+		return;
+	}
+
+	uint32_t slot = frame % _frames_in_flight;
+	cmd.dispatch().vkCmdWriteTimestamp2(cmd.buffer(), VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, _pool, slot * 2 + 1);
+	_pending[slot] = true;
+}
+
+std::optional<double> vk::GpuTimer::read_ms(uint32_t frame)
+{
+	uint32_t slot = frame % _frames_in_flight;
+	if (!_supported || !_pending[slot])
+	{
+		return std::nullopt;
+	}
+
+	uint64_t timestamps[2];
+	auto result = _device.dispatch().vkGetQueryPoolResults(_device.device(), _pool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result == VK_NOT_READY)
+	{
+		return std::nullopt;
+	}
+	vk_check(result);
+
+	_pending[slot] = false;
+
+	uint64_t ticks = ((timestamps[1] & _timestamp_mask) - (timestamps[0] & _timestamp_mask)) & _timestamp_mask;
+	return static_cast<double>(ticks) * _ns_per_tick / 1e6;
+}
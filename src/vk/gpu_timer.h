@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <optional>
+#include <vector>
+
+namespace vk {
+
+	class CommandBuffer;
+	class Device;
+
+	// Measures GPU time between two points in a command buffer with timestamp queries.
+	// Each frame in flight gets its own pair of queries, read back once that frame's fence has been waited on.
+	class GpuTimer {
+	public:
+		GpuTimer(vk::Device& device, uint32_t frames_in_flight);
+		~GpuTimer();
+
+		GpuTimer& operator=(const GpuTimer& other) = delete;
+		GpuTimer(const GpuTimer& other) = delete;
+
+		// False if the device can't do timestamps on the graphics queue family. Everything else is a no-op then.
+		bool supported() { return _supported; }
+
+		void begin(vk::CommandBuffer& cmd, uint32_t frame);
+		void end(vk::CommandBuffer& cmd, uint32_t frame);
+
+		// Time between begin and end the last time this frame slot was recorded, if it's finished.
+		std::optional<double> read_ms(uint32_t frame);
+
+	private:
+		vk::Device& _device;
+		VkQueryPool _pool = VK_NULL_HANDLE;
+		bool _supported;
+		uint32_t _frames_in_flight;
+		double _ns_per_tick;
+		// Bits above the queue family's timestampValidBits are undefined, and the counter wraps at the top of the rest.
+		uint64_t _timestamp_mask;
+
+		// Whether the slot has been written since it was last read.
+		std::vector<bool> _pending;
+	};
+
+}
@@ -0,0 +1,308 @@
+#include "host_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "logger.h"
+
+// Stored right in front of every allocation we hand out, since pfnFree only gives us the pointer back.
+struct AllocationHeader {
+	void* base;
+	size_t size;
+	uint32_t scope;
+	uint32_t size_class;
+};
+
+const size_t HEADER_SIZE = 32;
+const size_t MIN_ALIGNMENT = 16;
+const uint32_t NO_SIZE_CLASS = UINT32_MAX;
+
+static_assert(sizeof(AllocationHeader) <= HEADER_SIZE);
+
+// Block sizes include the header.
+const size_t POOL_BLOCK_SIZES[] = { 64, 128, 256, 512, 1024, 2048, 4096 };
+
+AllocationHeader* get_header(void* memory)
+{
+	return reinterpret_cast<AllocationHeader*>(static_cast<char*>(memory) - HEADER_SIZE);
+}
+
+vk::HostAllocator::HostAllocator(bool use_pools) : _use_pools(use_pools)
+{
+	static_assert(std::size(POOL_BLOCK_SIZES) == POOL_CLASS_COUNT);
+
+	for (size_t i = 0; i < POOL_CLASS_COUNT; i++)
+	{
+		_pools[i].block_size = POOL_BLOCK_SIZES[i];
+	}
+
+	_callbacks = {};
+	_callbacks.pUserData = this;
+	_callbacks.pfnAllocation = &HostAllocator::allocate;
+	_callbacks.pfnReallocation = &HostAllocator::reallocate;
+	_callbacks.pfnFree = &HostAllocator::free;
+	_callbacks.pfnInternalAllocation = &HostAllocator::internal_allocate;
+	_callbacks.pfnInternalFree = &HostAllocator::internal_free;
+}
+
+vk::HostAllocator::~HostAllocator()
+{
+	for (auto& pool : _pools)
+	{
+		for (void* chunk : pool.chunks)
+		{
+			std::free(chunk);
+		}
+	}
+}
+
+void* vk::HostAllocator::allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(user_data);
+	return allocator->allocate_block(size, alignment, scope);
+}
+
+void* vk::HostAllocator::reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(user_data);
+
+	if (original == nullptr)
+	{
+		return allocator->allocate_block(size, alignment, scope);
+	}
+
+	if (size == 0)
+	{
+		allocator->free_block(original);
+		return nullptr;
+	}
+
+	void* memory = allocator->allocate_block(size, alignment, scope);
+	if (memory == nullptr)
+	{
+		// The spec says the original allocation has to survive a failed reallocation.
+		return nullptr;
+	}
+
+	std::memcpy(memory, original, std::min(size, allocator->allocation_size(original)));
+	allocator->free_block(original);
+
+	return memory;
+}
+
+void vk::HostAllocator::free(void* user_data, void* memory)
+{
+	if (memory == nullptr)
+	{
+		return;
+	}
+
+	auto* allocator = static_cast<HostAllocator*>(user_data);
+	allocator->free_block(memory);
+}
+
+void vk::HostAllocator::internal_allocate(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(user_data);
+	allocator->_counters[scope].internal_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void vk::HostAllocator::internal_free(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope)
+{
+	auto* allocator = static_cast<HostAllocator*>(user_data);
+	allocator->_counters[scope].internal_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* vk::HostAllocator::allocate_block(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0)
+	{
+		return nullptr;
+	}
+
+	alignment = std::max(alignment, MIN_ALIGNMENT);
+
+	void* base = nullptr;
+	char* memory = nullptr;
+	uint32_t size_class = NO_SIZE_CLASS;
+
+	bool poolable = scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+	if (_use_pools && poolable && alignment == MIN_ALIGNMENT)
+	{
+		for (uint32_t i = 0; i < POOL_CLASS_COUNT; i++)
+		{
+			if (size + HEADER_SIZE <= _pools[i].block_size)
+			{
+				size_class = i;
+				break;
+			}
+		}
+	}
+
+	if (size_class != NO_SIZE_CLASS)
+	{
+		base = this->pool_allocate(size_class);
+		if (base == nullptr)
+		{
+			return nullptr;
+		}
+
+		// Pool blocks are always MIN_ALIGNMENT aligned, and so is the header.
+		memory = static_cast<char*>(base) + HEADER_SIZE;
+		_pooled_allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		base = std::malloc(size + alignment + HEADER_SIZE);
+		if (base == nullptr)
+		{
+			return nullptr;
+		}
+
+		uintptr_t unaligned = reinterpret_cast<uintptr_t>(base) + HEADER_SIZE;
+		uintptr_t aligned = (unaligned + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		memory = reinterpret_cast<char*>(aligned);
+	}
+
+	AllocationHeader* header = get_header(memory);
+	header->base = base;
+	header->size = size;
+	header->scope = scope;
+	header->size_class = size_class;
+
+	this->track_allocate(scope, size);
+
+	return memory;
+}
+
+void vk::HostAllocator::free_block(void* memory)
+{
+	AllocationHeader* header = get_header(memory);
+	this->track_free(static_cast<VkSystemAllocationScope>(header->scope), header->size);
+
+	if (header->size_class != NO_SIZE_CLASS)
+	{
+		this->pool_free(header->size_class, header->base);
+	}
+	else
+	{
+		std::free(header->base);
+	}
+}
+
+size_t vk::HostAllocator::allocation_size(void* memory)
+{
+	return get_header(memory)->size;
+}
+
+void* vk::HostAllocator::pool_allocate(size_t size_class)
+{
+	Pool& pool = _pools[size_class];
+	std::lock_guard guard(pool.lock);
+
+	if (pool.free_list == nullptr)
+	{
+		char* chunk = static_cast<char*>(std::malloc(POOL_CHUNK_SIZE));
+		if (chunk == nullptr)
+		{
+			return nullptr;
+		}
+		pool.chunks.push_back(chunk);
+
+		// Thread the new chunk's blocks onto the free list.
+		for (size_t offset = 0; offset + pool.block_size <= POOL_CHUNK_SIZE; offset += pool.block_size)
+		{
+			auto* block = reinterpret_cast<FreeBlock*>(chunk + offset);
+			block->next = pool.free_list;
+			pool.free_list = block;
+		}
+	}
+
+	FreeBlock* block = pool.free_list;
+	pool.free_list = block->next;
+
+	return block;
+}
+
+void vk::HostAllocator::pool_free(size_t size_class, void* block)
+{
+	Pool& pool = _pools[size_class];
+	std::lock_guard guard(pool.lock);
+
+	auto* free_block = static_cast<FreeBlock*>(block);
+	free_block->next = pool.free_list;
+	pool.free_list = free_block;
+}
+
+void vk::HostAllocator::track_allocate(VkSystemAllocationScope scope, size_t size)
+{
+	Counters& counters = _counters[scope];
+
+	uint64_t live = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	counters.live_allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.total_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !counters.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+}
+
+void vk::HostAllocator::track_free(VkSystemAllocationScope scope, size_t size)
+{
+	Counters& counters = _counters[scope];
+
+	counters.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+	counters.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+vk::HostAllocator::Stats vk::HostAllocator::stats()
+{
+	Stats stats = {};
+
+	for (size_t i = 0; i < SCOPE_COUNT; i++)
+	{
+		Counters& counters = _counters[i];
+		ScopeStats& scope = stats.scopes[i];
+
+		scope.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+		scope.peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+		scope.live_allocations = counters.live_allocations.load(std::memory_order_relaxed);
+		scope.total_allocations = counters.total_allocations.load(std::memory_order_relaxed);
+		scope.internal_bytes = counters.internal_bytes.load(std::memory_order_relaxed);
+	}
+
+	stats.pooled_allocations = _pooled_allocations.load(std::memory_order_relaxed);
+
+	for (auto& pool : _pools)
+	{
+		std::lock_guard guard(pool.lock);
+		stats.pool_reserved_bytes += pool.chunks.size() * POOL_CHUNK_SIZE;
+	}
+
+	return stats;
+}
+
+const char* SCOPE_NAMES[] = { "command", "object", "cache", "device", "instance" };
+
+void vk::HostAllocator::log_stats()
+{
+	Stats stats = this->stats();
+
+	for (size_t i = 0; i < SCOPE_COUNT; i++)
+	{
+		ScopeStats& scope = stats.scopes[i];
+		log(
+			"Host memory ({}): {} bytes in {} allocations, peak {} bytes, {} allocations total, {} internal bytes",
+			SCOPE_NAMES[i],
+			scope.live_bytes,
+			scope.live_allocations,
+			scope.peak_bytes,
+			scope.total_allocations,
+			scope.internal_bytes);
+	}
+
+	log("Host memory pools: {} pooled allocations, {} bytes reserved", stats.pooled_allocations, stats.pool_reserved_bytes);
+}
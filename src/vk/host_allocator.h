@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace vk {
+
+	// VkAllocationCallbacks that account for every host allocation the driver makes, per allocation scope.
+	// Command and object scope allocations are small and churn a lot, so they can optionally be served
+	// from size-classed pools instead of going through malloc.
+	class HostAllocator {
+	public:
+		static constexpr size_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+		struct ScopeStats {
+			uint64_t live_bytes;
+			uint64_t peak_bytes;
+			uint64_t live_allocations;
+			uint64_t total_allocations;
+			uint64_t internal_bytes;
+		};
+
+		struct Stats {
+			std::array<ScopeStats, SCOPE_COUNT> scopes;
+			uint64_t pooled_allocations;
+			uint64_t pool_reserved_bytes;
+		};
+
+		HostAllocator(bool use_pools);
+		~HostAllocator();
+
+		HostAllocator& operator=(const HostAllocator& other) = delete;
+		HostAllocator(const HostAllocator& other) = delete;
+
+		const VkAllocationCallbacks* callbacks() { return &_callbacks; }
+
+		Stats stats();
+		void log_stats();
+
+	private:
+		struct Counters {
+			std::atomic<uint64_t> live_bytes = 0;
+			std::atomic<uint64_t> peak_bytes = 0;
+			std::atomic<uint64_t> live_allocations = 0;
+			std::atomic<uint64_t> total_allocations = 0;
+			std::atomic<uint64_t> internal_bytes = 0;
+		};
+
+		struct FreeBlock {
+			FreeBlock* next;
+		};
+
+		struct Pool {
+			std::mutex lock;
+			size_t block_size;
+			FreeBlock* free_list = nullptr;
+			std::vector<void*> chunks;
+		};
+
+		static constexpr size_t POOL_CLASS_COUNT = 7;
+		static constexpr size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+		static VKAPI_ATTR void* VKAPI_CALL allocate(void* user_data, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL reallocate(void* user_data, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL free(void* user_data, void* memory);
+		static VKAPI_ATTR void VKAPI_CALL internal_allocate(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL internal_free(void* user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+		void* allocate_block(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void free_block(void* memory);
+		size_t allocation_size(void* memory);
+
+		void* pool_allocate(size_t size_class);
+		void pool_free(size_t size_class, void* block);
+
+		void track_allocate(VkSystemAllocationScope scope, size_t size);
+		void track_free(VkSystemAllocationScope scope, size_t size);
+
+		VkAllocationCallbacks _callbacks;
+		bool _use_pools;
+
+		std::array<Counters, SCOPE_COUNT> _counters;
+		std::array<Pool, POOL_CLASS_COUNT> _pools;
+		std::atomic<uint64_t> _pooled_allocations = 0;
+	};
+
+}
@@ -1,5 +1,16 @@
 #include "image.h"
 
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "command_buffer.h"
+#include "device.h"
+#include "vulkan_error.h"
+
 VkImageSubresourceRange vk::get_image_range(VkImageAspectFlags aspect) {
     VkImageSubresourceRange subresource = {};
 
@@ -12,7 +23,7 @@ VkImageSubresourceRange vk::get_image_range(VkImageAspectFlags aspect) {
     return subresource;
 }
 
-void vk::transition_image(VkCommandBuffer cmd, VkImage image, VkImageSubresourceRange range, ImageBarrierState old_state, ImageBarrierState new_state) {
+void vk::transition_image(vk::CommandBuffer& cmd, VkImage image, VkImageSubresourceRange range, ImageBarrierState old_state, ImageBarrierState new_state) {
     VkImageMemoryBarrier2 barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
 
@@ -34,5 +45,291 @@ void vk::transition_image(VkCommandBuffer cmd, VkImage image, VkImageSubresource
     dep_info.imageMemoryBarrierCount = 1;
     dep_info.pImageMemoryBarriers = &barrier;
 
-    vkCmdPipelineBarrier2(cmd, &dep_info);
-}
\ No newline at end of file
+    cmd.dispatch().vkCmdPipelineBarrier2(cmd.buffer(), &dep_info);
+}
+
+void vk::blit_image(vk::CommandBuffer& cmd, VkImage src, VkExtent2D src_extent, VkImage dst, VkExtent2D dst_extent, VkFilter filter) {
+    VkImageBlit2 region = {};
+    region.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.srcOffsets[1] = { static_cast<int32_t>(src_extent.width), static_cast<int32_t>(src_extent.height), 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstOffsets[1] = { static_cast<int32_t>(dst_extent.width), static_cast<int32_t>(dst_extent.height), 1 };
+
+    VkBlitImageInfo2 blit = {};
+    blit.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
+    blit.srcImage = src;
+    blit.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    blit.dstImage = dst;
+    blit.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    blit.regionCount = 1;
+    blit.pRegions = &region;
+    blit.filter = filter;
+
+    cmd.dispatch().vkCmdBlitImage2(cmd.buffer(), &blit);
+}
+
+VkImageView vk::create_image_view(vk::Device& device, VkImage image, VkFormat format, VkImageSubresourceRange range, VkImageViewType type) {
+    VkImageViewCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    info.image = image;
+
+    info.viewType = type;
+    info.format = format;
+
+    info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+    info.subresourceRange = range;
+
+    VkImageView view;
+    auto result = device.dispatch().vkCreateImageView(device.device(), &info, device.allocation_callbacks(), &view);
+    vk_check(result);
+
+    return view;
+}
+
+VkFormat vk::find_depth_format(vk::Device& device) {
+    const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+    for (VkFormat format : candidates)
+    {
+        if ((device.format_features(format) & VK_FORMAT_FEATURE_2_DEPTH_STENCIL_ATTACHMENT_BIT) != 0)
+        {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("No supported depth format.");
+}
+
+uint32_t vk::full_mip_count(VkExtent2D extent) {
+    return std::bit_width(std::max(extent.width, extent.height));
+}
+
+vk::Image::Image(vk::Device& device, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, uint32_t mip_levels, VkImageAspectFlags aspect, ImageMemory memory) :
+    _device(&device),
+    _owns_allocation(memory != ImageMemory::Unbound),
+    _format(format),
+    _extent(extent),
+    _mip_levels(mip_levels == ALL_MIPS ? full_mip_count(extent) : mip_levels),
+    _aspect(aspect)
+{
+    VkImageCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = format;
+    info.extent = { extent.width, extent.height, 1 };
+    info.mipLevels = _mip_levels;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = usage;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // Same as buffers, only images the uploader writes are shared with the streaming family. Concurrent sharing can
+    // turn off compression, so attachments and storage images stay exclusive.
+    auto families = device.resource_families();
+    if (families.size() > 1 && (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0)
+    {
+        info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        info.queueFamilyIndexCount = families.size();
+        info.pQueueFamilyIndices = families.data();
+    }
+    else
+    {
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    if (memory == ImageMemory::Unbound)
+    {
+        auto result = device.dispatch().vkCreateImage(device.device(), &info, device.allocation_callbacks(), &_image);
+        vk_check(result);
+        return;
+    }
+
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    if (memory == ImageMemory::Transient)
+    {
+        info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        if (device.physical_device().has_lazily_allocated_memory())
+        {
+            alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+        }
+    }
+
+    auto result = vmaCreateImage(device.allocator().allocator(), &info, &alloc_info, &_image, &_allocation, nullptr);
+    vk_check(result);
+
+    _view = create_image_view(device, _image, format, this->range());
+}
+
+VkMemoryRequirements vk::Image::memory_requirements()
+{
+    VkImageMemoryRequirementsInfo2 info = {};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.image = _image;
+
+    VkMemoryRequirements2 requirements = {};
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+
+    _device->dispatch().vkGetImageMemoryRequirements2(_device->device(), &info, &requirements);
+
+    return requirements.memoryRequirements;
+}
+
+void vk::Image::bind_memory(VmaAllocation allocation, VkDeviceSize offset)
+{
+    if (_owns_allocation)
+    {
+        throw std::runtime_error("Only unbound images can be bound to memory.");
+    }
+
+    auto result = vmaBindImageMemory2(_device->allocator().allocator(), allocation, offset, _image, nullptr);
+    vk_check(result);
+
+    _allocation = allocation;
+    _view = create_image_view(*_device, _image, _format, this->range());
+}
+
+vk::Image::~Image()
+{
+    this->release();
+}
+
+vk::Image::Image(Image&& other) :
+    _device(other._device),
+    _image(std::exchange(other._image, VK_NULL_HANDLE)),
+    _allocation(std::exchange(other._allocation, VK_NULL_HANDLE)),
+    _owns_allocation(other._owns_allocation),
+    _format(other._format),
+    _extent(other._extent),
+    _mip_levels(other._mip_levels),
+    _aspect(other._aspect),
+    _view(std::exchange(other._view, VK_NULL_HANDLE)),
+    _extra_views(std::move(other._extra_views))
+{
+    other._extra_views.clear();
+}
+
+vk::Image& vk::Image::operator=(Image&& other)
+{
+    if (this != &other)
+    {
+        this->release();
+
+        _device = other._device;
+        _image = std::exchange(other._image, VK_NULL_HANDLE);
+        _allocation = std::exchange(other._allocation, VK_NULL_HANDLE);
+        _owns_allocation = other._owns_allocation;
+        _format = other._format;
+        _extent = other._extent;
+        _mip_levels = other._mip_levels;
+        _aspect = other._aspect;
+        _view = std::exchange(other._view, VK_NULL_HANDLE);
+        _extra_views = std::move(other._extra_views);
+        other._extra_views.clear();
+    }
+
+    return *this;
+}
+
+void vk::Image::release()
+{
+    for (auto view : _extra_views)
+    {
+        _device->dispatch().vkDestroyImageView(_device->device(), view, _device->allocation_callbacks());
+    }
+    _extra_views.clear();
+
+    if (_view != VK_NULL_HANDLE)
+    {
+        _device->dispatch().vkDestroyImageView(_device->device(), _view, _device->allocation_callbacks());
+        _view = VK_NULL_HANDLE;
+    }
+
+    if (_image != VK_NULL_HANDLE)
+    {
+        if (_owns_allocation)
+        {
+            vmaDestroyImage(_device->allocator().allocator(), _image, _allocation);
+        }
+        else
+        {
+            _device->dispatch().vkDestroyImage(_device->device(), _image, _device->allocation_callbacks());
+        }
+        _image = VK_NULL_HANDLE;
+        _allocation = VK_NULL_HANDLE;
+    }
+}
+
+VkImageView vk::Image::create_view(uint32_t base_mip, uint32_t mip_count)
+{
+    VkImageSubresourceRange range = this->range();
+    range.baseMipLevel = base_mip;
+    range.levelCount = mip_count;
+
+    VkImageView view = create_image_view(*_device, _image, _format, range);
+    _extra_views.push_back(view);
+
+    return view;
+}
+
+void vk::Image::generate_mips(vk::CommandBuffer& cmd, ImageBarrierState final_state)
+{
+    const VkFormatFeatureFlags2 required = VK_FORMAT_FEATURE_2_BLIT_SRC_BIT | VK_FORMAT_FEATURE_2_BLIT_DST_BIT | VK_FORMAT_FEATURE_2_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((_device->format_features(_format) & required) != required)
+    {
+        throw std::runtime_error(fmt::format("Format {} doesn't support linear blits, can't generate mips.", static_cast<int>(_format)));
+    }
+
+    ImageBarrierState dst_state = { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+    ImageBarrierState src_state = { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT };
+
+    VkImageSubresourceRange level_range = this->range();
+    level_range.levelCount = 1;
+
+    int32_t width = static_cast<int32_t>(_extent.width);
+    int32_t height = static_cast<int32_t>(_extent.height);
+
+    for (uint32_t level = 1; level < _mip_levels; level++)
+    {
+        // The previous level is done being written, read from it.
+        level_range.baseMipLevel = level - 1;
+        transition_image(cmd, _image, level_range, dst_state, src_state);
+
+        int32_t next_width = std::max(width / 2, 1);
+        int32_t next_height = std::max(height / 2, 1);
+
+        VkImageBlit2 region = {};
+        region.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
+        region.srcSubresource = { _aspect, level - 1, 0, 1 };
+        region.srcOffsets[1] = { width, height, 1 };
+        region.dstSubresource = { _aspect, level, 0, 1 };
+        region.dstOffsets[1] = { next_width, next_height, 1 };
+
+        VkBlitImageInfo2 blit = {};
+        blit.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
+        blit.srcImage = _image;
+        blit.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        blit.dstImage = _image;
+        blit.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        blit.regionCount = 1;
+        blit.pRegions = &region;
+        blit.filter = VK_FILTER_LINEAR;
+
+        cmd.dispatch().vkCmdBlitImage2(cmd.buffer(), &blit);
+
+        transition_image(cmd, _image, level_range, src_state, final_state);
+
+        width = next_width;
+        height = next_height;
+    }
+
+    // The last level was only ever written.
+    level_range.baseMipLevel = _mip_levels - 1;
+    transition_image(cmd, _image, level_range, dst_state, final_state);
+}
@@ -1,15 +1,95 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <vector>
 
 namespace vk {
+	class CommandBuffer;
+	class Device;
+
 	VkImageSubresourceRange get_image_range(VkImageAspectFlags aspect);
 
 	struct ImageBarrierState {
 		VkImageLayout layout;
-		VkPipelineStageFlags stage;
+		VkPipelineStageFlags2 stage;
 		VkAccessFlags2 access;
 	};
 
-	void transition_image(VkCommandBuffer cmd, VkImage image, VkImageSubresourceRange range, ImageBarrierState old_state, ImageBarrierState new_state);
-}
\ No newline at end of file
+	void transition_image(vk::CommandBuffer& cmd, VkImage image, VkImageSubresourceRange range, ImageBarrierState old_state, ImageBarrierState new_state);
+
+	// Scales the first mip of src onto the first mip of dst. src has to be TRANSFER_SRC_OPTIMAL and dst TRANSFER_DST_OPTIMAL.
+	void blit_image(vk::CommandBuffer& cmd, VkImage src, VkExtent2D src_extent, VkImage dst, VkExtent2D dst_extent, VkFilter filter = VK_FILTER_LINEAR);
+
+	VkImageView create_image_view(vk::Device& device, VkImage image, VkFormat format, VkImageSubresourceRange range, VkImageViewType type = VK_IMAGE_VIEW_TYPE_2D);
+
+	// First of D32_SFLOAT, X8_D24 and D16 the device can render depth to.
+	VkFormat find_depth_format(vk::Device& device);
+
+	// Number of levels in a full mip chain, down to 1x1.
+	uint32_t full_mip_count(VkExtent2D extent);
+
+	enum class ImageMemory {
+		// Its own device local allocation.
+		Dedicated,
+		// Attachments that only live inside a render pass. Lazily allocated (i.e. possibly never backed at all) where
+		// the device supports it, plain device local otherwise. Usage can only contain attachment bits.
+		Transient,
+		// No memory until bind_memory, for placing several images in one allocation, see render::AttachmentPool.
+		Unbound,
+	};
+
+	// A 2D image with its own memory and views.
+	class Image {
+	public:
+		// Pass as mip_levels to get the whole chain.
+		static constexpr uint32_t ALL_MIPS = 0;
+
+		Image(vk::Device& device, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, uint32_t mip_levels = 1, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, ImageMemory memory = ImageMemory::Dedicated);
+		~Image();
+
+		Image& operator=(const Image& other) = delete;
+		Image(const Image& other) = delete;
+
+		Image(Image&& other);
+		Image& operator=(Image&& other);
+
+		VkImage image() { return _image; }
+		VkFormat format() { return _format; }
+		VkExtent2D extent() { return _extent; }
+		uint32_t mip_levels() { return _mip_levels; }
+		VkImageAspectFlags aspect() { return _aspect; }
+		VkImageSubresourceRange range() { return get_image_range(_aspect); }
+
+		// Covers every mip level.
+		VkImageView view() { return _view; }
+
+		// Only for ImageMemory::Unbound images. The image doesn't own the allocation, and views can't be made until this is called.
+		VkMemoryRequirements memory_requirements();
+		void bind_memory(VmaAllocation allocation, VkDeviceSize offset);
+
+		// Extra views onto a subset of the mips. They live as long as the image does.
+		VkImageView create_view(uint32_t base_mip, uint32_t mip_count);
+
+		// Fills in every level below the first with a chain of linear blits.
+		// Expects the whole image in TRANSFER_DST_OPTIMAL with level 0 written by a transfer, and leaves it all in final_state.
+		// Needs a graphics queue.
+		void generate_mips(vk::CommandBuffer& cmd, ImageBarrierState final_state);
+
+	private:
+		void release();
+
+		vk::Device* _device;
+		VkImage _image = VK_NULL_HANDLE;
+		VmaAllocation _allocation = VK_NULL_HANDLE;
+		bool _owns_allocation;
+		VkFormat _format;
+		VkExtent2D _extent;
+		uint32_t _mip_levels;
+		VkImageAspectFlags _aspect;
+
+		VkImageView _view = VK_NULL_HANDLE;
+		std::vector<VkImageView> _extra_views;
+	};
+}
@@ -0,0 +1,171 @@
+#include "object_cache.h"
+
+#include <stdexcept>
+
+#include "device.h"
+#include "vulkan_error.h"
+
+size_t vk::hash_words(std::span<const uint32_t> words)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : words)
+	{
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+vk::ObjectCache::ObjectCache(vk::Device& device) : _device(device)
+{
+}
+
+void vk::ObjectCache::destroy()
+{
+	std::scoped_lock lock(_mutex);
+
+	// Pipelines before the layouts they were made with, pipeline layouts before their set layouts.
+	for (auto& [key, pipeline] : _pipelines)
+	{
+		_device.dispatch().vkDestroyPipeline(_device.device(), pipeline, _device.allocation_callbacks());
+	}
+	for (auto& [key, layout] : _pipeline_layouts)
+	{
+		_device.dispatch().vkDestroyPipelineLayout(_device.device(), layout, _device.allocation_callbacks());
+	}
+	for (auto& [key, layout] : _set_layouts)
+	{
+		_device.dispatch().vkDestroyDescriptorSetLayout(_device.device(), layout, _device.allocation_callbacks());
+	}
+
+	_pipelines.clear();
+	_pipeline_layouts.clear();
+	_set_layouts.clear();
+}
+
+VkDescriptorSetLayout vk::ObjectCache::descriptor_set_layout(const VkDescriptorSetLayoutCreateInfo& info)
+{
+	const VkDescriptorSetLayoutBindingFlagsCreateInfo* flags_info = nullptr;
+	if (info.pNext != nullptr)
+	{
+		flags_info = static_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(info.pNext);
+		if (flags_info->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO || flags_info->pNext != nullptr)
+		{
+			throw std::runtime_error("ObjectCache can only cache descriptor set layouts chained with binding flags.");
+		}
+	}
+
+	CacheKey key;
+	key.add(info.flags);
+	key.add(info.bindingCount);
+	for (uint32_t i = 0; i < info.bindingCount; i++)
+	{
+		const VkDescriptorSetLayoutBinding& binding = info.pBindings[i];
+		key.add(binding.binding);
+		key.add(static_cast<uint32_t>(binding.descriptorType));
+		key.add(binding.descriptorCount);
+		key.add(binding.stageFlags);
+
+		bool immutable_samplers = binding.pImmutableSamplers != nullptr;
+		key.add(immutable_samplers);
+		for (uint32_t s = 0; immutable_samplers && s < binding.descriptorCount; s++)
+		{
+			key.add_handle(binding.pImmutableSamplers[s]);
+		}
+	}
+	key.add(flags_info != nullptr ? flags_info->bindingCount : 0);
+	for (uint32_t i = 0; flags_info != nullptr && i < flags_info->bindingCount; i++)
+	{
+		key.add(flags_info->pBindingFlags[i]);
+	}
+
+	// Layouts are quick to make, so unlike pipelines they're made under the lock.
+	std::scoped_lock lock(_mutex);
+
+	auto it = _set_layouts.find(key);
+	if (it != _set_layouts.end())
+	{
+		return it->second;
+	}
+
+	VkDescriptorSetLayout layout;
+	auto result = _device.dispatch().vkCreateDescriptorSetLayout(_device.device(), &info, _device.allocation_callbacks(), &layout);
+	vk_check(result);
+
+	_set_layouts.emplace(std::move(key), layout);
+
+	return layout;
+}
+
+VkPipelineLayout vk::ObjectCache::pipeline_layout(const VkPipelineLayoutCreateInfo& info)
+{
+	if (info.pNext != nullptr)
+	{
+		throw std::runtime_error("ObjectCache can't cache chained pipeline layout create infos.");
+	}
+
+	// Set layouts from descriptor_set_layout are one handle per content, so the handles can stand in for it.
+	CacheKey key;
+	key.add(info.flags);
+	key.add(info.setLayoutCount);
+	for (uint32_t i = 0; i < info.setLayoutCount; i++)
+	{
+		key.add_handle(info.pSetLayouts[i]);
+	}
+	key.add(info.pushConstantRangeCount);
+	for (uint32_t i = 0; i < info.pushConstantRangeCount; i++)
+	{
+		key.add(info.pPushConstantRanges[i].stageFlags);
+		key.add(info.pPushConstantRanges[i].offset);
+		key.add(info.pPushConstantRanges[i].size);
+	}
+
+	std::scoped_lock lock(_mutex);
+
+	auto it = _pipeline_layouts.find(key);
+	if (it != _pipeline_layouts.end())
+	{
+		return it->second;
+	}
+
+	VkPipelineLayout layout;
+	auto result = _device.dispatch().vkCreatePipelineLayout(_device.device(), &info, _device.allocation_callbacks(), &layout);
+	vk_check(result);
+
+	_pipeline_layouts.emplace(std::move(key), layout);
+
+	return layout;
+}
+
+VkPipeline vk::ObjectCache::pipeline(const CacheKey& key, const std::function<VkPipeline()>& create)
+{
+	{
+		std::scoped_lock lock(_mutex);
+
+		auto it = _pipelines.find(key);
+		if (it != _pipelines.end())
+		{
+			return it->second;
+		}
+	}
+
+	VkPipeline pipeline = create();
+
+	std::scoped_lock lock(_mutex);
+
+	// Somebody else may have built the same thing in the meantime, in which case theirs wins.
+	auto [it, inserted] = _pipelines.emplace(key, pipeline);
+	if (!inserted)
+	{
+		_device.dispatch().vkDestroyPipeline(_device.device(), pipeline, _device.allocation_callbacks());
+	}
+
+	return it->second;
+}
+
+size_t vk::ObjectCache::size()
+{
+	std::scoped_lock lock(_mutex);
+	return _set_layouts.size() + _pipeline_layouts.size() + _pipelines.size();
+}
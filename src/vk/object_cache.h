@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace vk {
+
+	class Device;
+
+	// FNV-1a, for hashing create infos that have been flattened into words.
+	size_t hash_words(std::span<const uint32_t> words);
+
+	// Everything in a create info that matters, flattened into words so equality and hashing agree. Floats go in as
+	// their bit patterns and handles as two words.
+	struct CacheKey {
+		std::vector<uint32_t> words;
+
+		void add(uint32_t word) { words.push_back(word); }
+		void add_float(float value) { words.push_back(std::bit_cast<uint32_t>(value)); }
+		// Size first, so two spans in a row can't be mistaken for a different split of the same words.
+		void add_words(std::span<const uint32_t> data)
+		{
+			words.push_back(static_cast<uint32_t>(data.size()));
+			words.insert(words.end(), data.begin(), data.end());
+		}
+		template <typename T>
+		void add_handle(T handle)
+		{
+			uint64_t bits = (uint64_t)handle;
+			words.push_back(static_cast<uint32_t>(bits));
+			words.push_back(static_cast<uint32_t>(bits >> 32));
+		}
+
+		bool operator==(const CacheKey& other) const = default;
+	};
+
+	struct CacheKeyHash {
+		size_t operator()(const CacheKey& key) const { return hash_words(key.words); }
+	};
+
+	// Descriptor set layouts, pipeline layouts and pipelines, shared by everything that asks for the same thing.
+	// Besides not making the driver keep duplicates around, identical layouts come back as the same handle, so
+	// pipelines built separately stay layout compatible and binding one after another doesn't disturb bound sets.
+	// Owned by the device, everything is destroyed with it. Samplers have their own SamplerCache.
+	class ObjectCache {
+	public:
+		ObjectCache(vk::Device& device);
+		void destroy();
+
+		ObjectCache& operator=(const ObjectCache& other) = delete;
+		ObjectCache(const ObjectCache& other) = delete;
+
+		// VkDescriptorSetLayoutBindingFlagsCreateInfo is the only thing that can be chained.
+		VkDescriptorSetLayout descriptor_set_layout(const VkDescriptorSetLayoutCreateInfo& info);
+		// Nothing can be chained.
+		VkPipelineLayout pipeline_layout(const VkPipelineLayoutCreateInfo& info);
+		// Pipeline create infos are too big to flatten in general, so the builders make the key out of whatever they
+		// let be set. create only runs on a miss, and not under the lock, so pipelines still compile in parallel.
+		VkPipeline pipeline(const CacheKey& key, const std::function<VkPipeline()>& create);
+
+		size_t size();
+
+	private:
+		vk::Device& _device;
+
+		std::mutex _mutex;
+		std::unordered_map<CacheKey, VkDescriptorSetLayout, CacheKeyHash> _set_layouts;
+		std::unordered_map<CacheKey, VkPipelineLayout, CacheKeyHash> _pipeline_layouts;
+		std::unordered_map<CacheKey, VkPipeline, CacheKeyHash> _pipelines;
+	};
+
+}
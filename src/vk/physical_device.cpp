@@ -1,5 +1,10 @@
 #include "physical_device.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include <fmt/format.h>
+
 #include "logger.h"
 #include "vulkan_error.h"
 
@@ -12,30 +17,45 @@ const std::vector<const char *> PhysicalDevice::REQUIRED_DEVICE_EXTENSIONS = {
 #endif
 };
 
-PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface) : device(device)
+PhysicalDevice::PhysicalDevice(const vk::InstanceDispatch &dispatch, VkPhysicalDevice device, VkSurfaceKHR surface) : device(device)
 {
+	this->id_properties = {};
+	this->id_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
 	this->properties = {};
 	this->properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-	vkGetPhysicalDeviceProperties2(device, &this->properties);
+	this->properties.pNext = &this->id_properties;
+	dispatch.vkGetPhysicalDeviceProperties2(device, &this->properties);
+	// We get copied around, so don't keep pointers into ourselves.
+	this->properties.pNext = nullptr;
+
+	this->memory_properties = {};
+	this->memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	dispatch.vkGetPhysicalDeviceMemoryProperties2(device, &this->memory_properties);
+
+	this->features12 = {};
+	this->features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 
 	this->features = {};
 	this->features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-	vkGetPhysicalDeviceFeatures2(device, &this->features);
+	this->features.pNext = &this->features12;
+	dispatch.vkGetPhysicalDeviceFeatures2(device, &this->features);
+	this->features.pNext = nullptr;
 
 	uint32_t num_queue_families;
-	vkGetPhysicalDeviceQueueFamilyProperties2(device, &num_queue_families, nullptr);
+	dispatch.vkGetPhysicalDeviceQueueFamilyProperties2(device, &num_queue_families, nullptr);
 
 	VkQueueFamilyProperties2 default_queue_family = {};
 	default_queue_family.sType = VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2;
 	this->queue_families.resize(num_queue_families, default_queue_family);
-	vkGetPhysicalDeviceQueueFamilyProperties2(device, &num_queue_families, this->queue_families.data());
+	dispatch.vkGetPhysicalDeviceQueueFamilyProperties2(device, &num_queue_families, this->queue_families.data());
 
 	uint32_t num_extensions;
-	auto result = vkEnumerateDeviceExtensionProperties(device, nullptr, &num_extensions, nullptr);
+	auto result = dispatch.vkEnumerateDeviceExtensionProperties(device, nullptr, &num_extensions, nullptr);
 	vk_check(result);
 
 	this->extensions.resize(num_extensions);
-	result = vkEnumerateDeviceExtensionProperties(device, nullptr, &num_extensions, this->extensions.data());
+	result = dispatch.vkEnumerateDeviceExtensionProperties(device, nullptr, &num_extensions, this->extensions.data());
 	vk_check(result);
 
 	VkPhysicalDeviceSurfaceInfo2KHR surface_info = {};
@@ -43,28 +63,29 @@ PhysicalDevice::PhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface) :
 	surface_info.surface = surface;
 
 	this->surface_caps = {};
-	result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(this->device, surface, &this->surface_caps);
+	result = dispatch.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(this->device, surface, &this->surface_caps);
 	vk_check(result);
 
 	uint32_t num_formats;
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(this->device, surface, &num_formats, nullptr);
+	result = dispatch.vkGetPhysicalDeviceSurfaceFormatsKHR(this->device, surface, &num_formats, nullptr);
 	vk_check(result);
 
 	this->surface_formats.resize(num_formats);
-	result = vkGetPhysicalDeviceSurfaceFormatsKHR(this->device, surface, &num_formats, this->surface_formats.data());
+	result = dispatch.vkGetPhysicalDeviceSurfaceFormatsKHR(this->device, surface, &num_formats, this->surface_formats.data());
 	vk_check(result);
 
 	uint32_t num_modes;
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(this->device, surface, &num_modes, nullptr);
+	result = dispatch.vkGetPhysicalDeviceSurfacePresentModesKHR(this->device, surface, &num_modes, nullptr);
 	vk_check(result);
 
 	this->present_modes.resize(num_modes);
-	result = vkGetPhysicalDeviceSurfacePresentModesKHR(this->device, surface, &num_modes, this->present_modes.data());
+	result = dispatch.vkGetPhysicalDeviceSurfacePresentModesKHR(this->device, surface, &num_modes, this->present_modes.data());
 
 	this->graphics_families = get_queue_families_for_type(VK_QUEUE_GRAPHICS_BIT);
 	this->transfer_families = get_queue_families_for_type(VK_QUEUE_TRANSFER_BIT);
+	this->compute_families = get_queue_families_for_type(VK_QUEUE_COMPUTE_BIT);
 
-	this->present_families = get_present_families(surface);
+	this->present_families = get_present_families(dispatch, surface);
 }
 
 bool PhysicalDevice::is_usable()
@@ -96,14 +117,161 @@ bool PhysicalDevice::is_usable()
 		}
 	}
 
+	if (!this->has_bindless_features())
+	{
+		log("Descriptor indexing features not found.");
+		return false;
+	}
+
+	if (!this->has_indirect_features())
+	{
+		log("Indirect draw features not found.");
+		return false;
+	}
+
 	return true;
 }
 
+bool PhysicalDevice::has_bindless_features()
+{
+	auto &f = this->features12;
+	return f.runtimeDescriptorArray &&
+		   f.descriptorBindingPartiallyBound &&
+		   f.descriptorBindingUpdateUnusedWhilePending &&
+		   f.descriptorBindingSampledImageUpdateAfterBind &&
+		   f.descriptorBindingStorageBufferUpdateAfterBind &&
+		   f.descriptorBindingStorageImageUpdateAfterBind &&
+		   f.shaderSampledImageArrayNonUniformIndexing &&
+		   f.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+bool PhysicalDevice::has_indirect_features()
+{
+	return this->features.features.multiDrawIndirect &&
+		   this->features.features.drawIndirectFirstInstance &&
+		   this->features12.drawIndirectCount;
+}
+
 std::string_view PhysicalDevice::get_name()
 {
 	return this->properties.properties.deviceName;
 }
 
+std::string PhysicalDevice::get_uuid()
+{
+	const uint8_t *id = this->id_properties.deviceUUID;
+	return fmt::format(
+		"{:02x}{:02x}{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}{:02x}{:02x}{:02x}{:02x}",
+		id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7],
+		id[8], id[9], id[10], id[11], id[12], id[13], id[14], id[15]);
+}
+
+VkDeviceSize PhysicalDevice::get_device_local_memory()
+{
+	// Integrated GPUs report (some of) system memory as device local, which is fine - it's what they get to use.
+	VkDeviceSize largest = 0;
+	auto &props = this->memory_properties.memoryProperties;
+	for (uint32_t i = 0; i < props.memoryHeapCount; i++)
+	{
+		if ((props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0)
+		{
+			largest = std::max(largest, props.memoryHeaps[i].size);
+		}
+	}
+
+	return largest;
+}
+
+bool PhysicalDevice::has_lazily_allocated_memory()
+{
+	auto &props = this->memory_properties.memoryProperties;
+	for (uint32_t i = 0; i < props.memoryTypeCount; i++)
+	{
+		if ((props.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool PhysicalDevice::has_dedicated_transfer_family()
+{
+	for (auto idx : this->transfer_families)
+	{
+		VkQueueFlags flags = this->queue_families[idx].queueFamilyProperties.queueFlags;
+		if ((flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool PhysicalDevice::has_dedicated_compute_family()
+{
+	for (auto idx : this->compute_families)
+	{
+		VkQueueFlags flags = this->queue_families[idx].queueFamilyProperties.queueFlags;
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint64_t PhysicalDevice::score()
+{
+	// Device type dominates everything else, so a discrete GPU always wins over an integrated one with a big shared heap.
+	uint64_t score = 0;
+	switch (this->get_device_type())
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		score += 1000000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		score += 100000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		score += 10000;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		score += 1000;
+		break;
+	default:
+		break;
+	}
+
+	// Then VRAM, one point per 64 MiB.
+	score += std::min<uint64_t>(this->get_device_local_memory() >> 26, 10000);
+
+	// Separate families let us run uploads and compute alongside the frame.
+	if (this->has_dedicated_transfer_family())
+	{
+		score += 500;
+	}
+	if (this->has_dedicated_compute_family())
+	{
+		score += 500;
+	}
+
+	auto &features = this->get_features();
+	if (features.multiDrawIndirect)
+	{
+		score += 250;
+	}
+	if (features.samplerAnisotropy)
+	{
+		score += 100;
+	}
+
+	return score;
+}
+
 std::optional<uint32_t> PhysicalDevice::get_graphics_family()
 {
 	if (this->graphics_families.size() == 0)
@@ -152,6 +320,16 @@ std::optional<uint32_t> PhysicalDevice::get_present_family()
 	return std::nullopt;
 }
 
+uint32_t PhysicalDevice::get_queue_count(uint32_t family)
+{
+	return this->queue_families.at(family).queueFamilyProperties.queueCount;
+}
+
+uint32_t PhysicalDevice::get_timestamp_valid_bits(uint32_t family)
+{
+	return this->queue_families.at(family).queueFamilyProperties.timestampValidBits;
+}
+
 std::vector<uint32_t> PhysicalDevice::get_queue_families_for_type(VkQueueFlags ty)
 {
 	std::vector<uint32_t> families;
@@ -166,13 +344,13 @@ std::vector<uint32_t> PhysicalDevice::get_queue_families_for_type(VkQueueFlags t
 	return families;
 }
 
-std::vector<uint32_t> PhysicalDevice::get_present_families(VkSurfaceKHR surface)
+std::vector<uint32_t> PhysicalDevice::get_present_families(const vk::InstanceDispatch &dispatch, VkSurfaceKHR surface)
 {
 	std::vector<uint32_t> families;
 	for (int i = 0; i < this->queue_families.size(); i++)
 	{
 		VkBool32 supported;
-		auto result = vkGetPhysicalDeviceSurfaceSupportKHR(this->device, i, surface, &supported);
+		auto result = dispatch.vkGetPhysicalDeviceSurfaceSupportKHR(this->device, i, surface, &supported);
 		vk_check(result);
 
 		if (supported)
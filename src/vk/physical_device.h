@@ -3,22 +3,47 @@
 #include <vulkan/vulkan.h>
 
 #include <vector>
+#include <string>
 #include <string_view>
 #include <optional>
 
+#include "dispatch.h"
+
 class PhysicalDevice
 {
 public:
-    PhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface);
+    PhysicalDevice(const vk::InstanceDispatch &dispatch, VkPhysicalDevice device, VkSurfaceKHR surface);
     bool is_usable();
 
     std::string_view get_name();
+    std::string get_uuid();
     VkPhysicalDevice get_device() { return this->device; }
 
+    VkPhysicalDeviceType get_device_type() { return this->properties.properties.deviceType; }
+    VkPhysicalDeviceLimits &get_limits() { return this->properties.properties.limits; }
+    VkPhysicalDeviceFeatures &get_features() { return this->features.features; }
+    VkPhysicalDeviceVulkan12Features &get_features12() { return this->features12; }
+    VkDeviceSize get_device_local_memory();
+    // Tilers can back transient attachments with memory that never actually gets committed.
+    bool has_lazily_allocated_memory();
+
+    bool has_dedicated_transfer_family();
+    bool has_dedicated_compute_family();
+    // Everything the bindless heap needs from descriptor indexing.
+    bool has_bindless_features();
+    // Multi draw indirect with a GPU written count and firstInstance.
+    bool has_indirect_features();
+
+    // Higher is better. Only meaningful when comparing usable devices.
+    uint64_t score();
+
     std::optional<uint32_t> get_graphics_family();
     std::optional<uint32_t> get_transfer_family();
     std::optional<uint32_t> get_present_family();
 
+    uint32_t get_queue_count(uint32_t family);
+    uint32_t get_timestamp_valid_bits(uint32_t family);
+
     std::vector<VkSurfaceFormatKHR> &get_surface_formats() { return this->surface_formats; }
     std::vector<VkPresentModeKHR> &get_present_modes() { return this->present_modes; }
     VkSurfaceCapabilitiesKHR &get_surface_caps() { return this->surface_caps; }
@@ -28,12 +53,16 @@ public:
 private:
     VkPhysicalDevice device;
     VkPhysicalDeviceProperties2 properties;
+    VkPhysicalDeviceIDProperties id_properties;
     VkPhysicalDeviceFeatures2 features;
+    VkPhysicalDeviceVulkan12Features features12;
+    VkPhysicalDeviceMemoryProperties2 memory_properties;
     std::vector<VkExtensionProperties> extensions;
     std::vector<VkQueueFamilyProperties2> queue_families;
 
     std::vector<uint32_t> graphics_families;
     std::vector<uint32_t> transfer_families;
+    std::vector<uint32_t> compute_families;
     std::vector<uint32_t> present_families;
 
     VkSurfaceCapabilitiesKHR surface_caps;
@@ -41,5 +70,5 @@ private:
     std::vector<VkPresentModeKHR> present_modes;
 
     std::vector<uint32_t> get_queue_families_for_type(VkQueueFlags ty);
-    std::vector<uint32_t> get_present_families(VkSurfaceKHR surface);
+    std::vector<uint32_t> get_present_families(const vk::InstanceDispatch &dispatch, VkSurfaceKHR surface);
 };
\ No newline at end of file
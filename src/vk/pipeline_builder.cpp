@@ -16,12 +16,8 @@ vk::PipelineBuilder::PipelineBuilder(vk::Device& device) : _device(device)
 
 }
 
-// Maybe move this to a class one day, idk.
-VkShaderModule create_shader_module(VkDevice device, std::string_view filename)
+std::vector<uint32_t> read_shader_file(std::string_view filename)
 {
-	VkShaderModuleCreateInfo info = {};
-	info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-
 	std::string filename_owned(filename);
 	std::fstream file(filename_owned, std::ifstream::ate | std::ifstream::binary | std::ifstream::in);
 	if (!file.good())
@@ -30,15 +26,29 @@ VkShaderModule create_shader_module(VkDevice device, std::string_view filename)
 	}
 
 	size_t len = static_cast<size_t>(file.tellg());
-	std::vector<char> data(len);
+	if (len == 0 || len % sizeof(uint32_t) != 0)
+	{
+		throw std::runtime_error(fmt::format("{} isn't SPIR-V.", filename));
+	}
+
+	std::vector<uint32_t> code(len / sizeof(uint32_t));
 	file.seekg(0);
-	file.read(data.data(), len);
+	file.read(reinterpret_cast<char*>(code.data()), len);
 
-	info.codeSize = len;
-	info.pCode = (uint32_t*)data.data();
+	return code;
+}
+
+// Maybe move this to a class one day, idk.
+VkShaderModule create_shader_module(vk::Device& device, const std::vector<uint32_t>& code)
+{
+	VkShaderModuleCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+	info.codeSize = code.size() * sizeof(uint32_t);
+	info.pCode = code.data();
 
 	VkShaderModule module;
-	auto result = vkCreateShaderModule(device, &info, nullptr, &module);
+	auto result = device.dispatch().vkCreateShaderModule(device.device(), &info, device.allocation_callbacks(), &module);
 	vk_check(result);
 
 	return module;
@@ -46,12 +56,12 @@ VkShaderModule create_shader_module(VkDevice device, std::string_view filename)
 
 void vk::PipelineBuilder::set_vertex_shader_from_file(std::string_view filename)
 {
-	_vertex_shader = create_shader_module(this->_device.device(), filename);
+	_vertex_code = read_shader_file(filename);
 }
 
 void vk::PipelineBuilder::set_fragment_shader_from_file(std::string_view filename)
 {
-	_fragment_shader = create_shader_module(this->_device.device(), filename);
+	_fragment_code = read_shader_file(filename);
 }
 
 VkPipelineShaderStageCreateInfo create_shader_stage_info(VkShaderModule shader, VkShaderStageFlagBits stage)
@@ -76,26 +86,158 @@ void vk::PipelineBuilder::set_depth_format(VkFormat format)
 	_depth_format = format;
 }
 
-vk::GraphicsPipeline vk::PipelineBuilder::build()
+void vk::PipelineBuilder::set_depth_test(bool write, VkCompareOp compare_op)
+{
+	_depth_test = true;
+	_depth_write = write;
+	_depth_compare_op = compare_op;
+}
+
+vk::VertexLayout& vk::VertexLayout::binding(uint32_t binding, uint32_t stride, VkVertexInputRate rate)
+{
+	VkVertexInputBindingDescription desc = {};
+	desc.binding = binding;
+	desc.stride = stride;
+	desc.inputRate = rate;
+
+	bindings.push_back(desc);
+	return *this;
+}
+
+vk::VertexLayout& vk::VertexLayout::attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset)
+{
+	VkVertexInputAttributeDescription desc = {};
+	desc.location = location;
+	desc.binding = binding;
+	desc.format = format;
+	desc.offset = offset;
+
+	attributes.push_back(desc);
+	return *this;
+}
+
+void vk::PipelineBuilder::set_vertex_layout(const VertexLayout& layout)
+{
+	_vertex_layout = layout;
+}
+
+void vk::PipelineBuilder::set_index_restart(bool enabled)
 {
-	if (_vertex_shader == VK_NULL_HANDLE || _fragment_shader == VK_NULL_HANDLE)
+	_index_restart = enabled;
+}
+
+void vk::PipelineBuilder::set_push_constant_range(VkShaderStageFlags stages, uint32_t size)
+{
+	_push_constant_stages = stages;
+	_push_constant_size = size;
+	_push_constant_type = nullptr;
+}
+
+void vk::PipelineBuilder::set_layout(VkPipelineLayout layout)
+{
+	_layout = layout;
+}
+
+VkPipelineLayout get_pipeline_layout(vk::Device& device, VkShaderStageFlags push_constant_stages, uint32_t push_constant_size)
+{
+	VkPipelineLayoutCreateInfo layout_info = {};
+	layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	// No descriptor sets, those come with the bindless layout.
+
+	VkPushConstantRange push_constant_range = {};
+	push_constant_range.stageFlags = push_constant_stages;
+	push_constant_range.offset = 0;
+	push_constant_range.size = push_constant_size;
+	if (push_constant_size != 0)
+	{
+		layout_info.pushConstantRangeCount = 1;
+		layout_info.pPushConstantRanges = &push_constant_range;
+	}
+
+	return device.objects().pipeline_layout(layout_info);
+}
+
+vk::Pipeline vk::PipelineBuilder::build()
+{
+	if (_vertex_code.empty())
+	{
+		throw std::runtime_error("Vertex shader must be set.");
+	}
+
+	bool depth_only = _color_format == VK_FORMAT_UNDEFINED;
+	if (depth_only && _depth_format == VK_FORMAT_UNDEFINED)
 	{
-		throw std::runtime_error("Vertex and fragment shader must be set.");
+		throw std::runtime_error("Color or depth format must be set.");
 	}
 
-	if (_color_format == VK_FORMAT_UNDEFINED)
+	if (!depth_only && _fragment_code.empty())
 	{
-		throw std::runtime_error("Color format must be set.");
+		throw std::runtime_error("Fragment shader must be set when there's a color attachment.");
 	}
 
+	VkPipelineLayout layout = _layout;
+	if (layout == VK_NULL_HANDLE)
+	{
+		layout = get_pipeline_layout(_device, _push_constant_stages, _push_constant_size);
+	}
+
+	// Everything that can be set on the builder. The rest of the create info is the same for every pipeline.
+	CacheKey key;
+	key.add(static_cast<uint32_t>(VK_PIPELINE_BIND_POINT_GRAPHICS));
+	key.add_words(_vertex_code);
+	key.add_words(_fragment_code);
+	key.add(static_cast<uint32_t>(_color_format));
+	key.add(static_cast<uint32_t>(_depth_format));
+	key.add(_depth_test);
+	key.add(_depth_write);
+	key.add(static_cast<uint32_t>(_depth_compare_op));
+	key.add(static_cast<uint32_t>(_vertex_layout.bindings.size()));
+	for (const VkVertexInputBindingDescription& binding : _vertex_layout.bindings)
+	{
+		key.add(binding.binding);
+		key.add(binding.stride);
+		key.add(static_cast<uint32_t>(binding.inputRate));
+	}
+	key.add(static_cast<uint32_t>(_vertex_layout.attributes.size()));
+	for (const VkVertexInputAttributeDescription& attribute : _vertex_layout.attributes)
+	{
+		key.add(attribute.location);
+		key.add(attribute.binding);
+		key.add(static_cast<uint32_t>(attribute.format));
+		key.add(attribute.offset);
+	}
+	key.add(_index_restart);
+	key.add_handle(layout);
+
+	VkPipeline pipeline = _device.objects().pipeline(key, [&]() { return this->create_pipeline(layout, depth_only); });
+
+	return {
+		pipeline,
+		layout,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		_push_constant_size,
+		_push_constant_type
+	};
+}
+
+VkPipeline vk::PipelineBuilder::create_pipeline(VkPipelineLayout layout, bool depth_only)
+{
 	VkGraphicsPipelineCreateInfo info = {};
 	info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 
-	auto vertex_stage = create_shader_stage_info(_vertex_shader, VK_SHADER_STAGE_VERTEX_BIT);
-	auto fragment_stage = create_shader_stage_info(_fragment_shader, VK_SHADER_STAGE_FRAGMENT_BIT);
-	VkPipelineShaderStageCreateInfo stages[2] = {vertex_stage, fragment_stage};
+	VkShaderModule vertex_shader = create_shader_module(_device, _vertex_code);
+	VkShaderModule fragment_shader = VK_NULL_HANDLE;
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0] = create_shader_stage_info(vertex_shader, VK_SHADER_STAGE_VERTEX_BIT);
+	info.stageCount = 1;
+	if (!_fragment_code.empty())
+	{
+		fragment_shader = create_shader_module(_device, _fragment_code);
+		stages[1] = create_shader_stage_info(fragment_shader, VK_SHADER_STAGE_FRAGMENT_BIT);
+		info.stageCount = 2;
+	}
 
-	info.stageCount = 2;
 	info.pStages = stages;
 
 	VkPipelineViewportStateCreateInfo viewport_info = {};
@@ -107,13 +249,17 @@ vk::GraphicsPipeline vk::PipelineBuilder::build()
 
 	VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
 	vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_info.vertexBindingDescriptionCount = _vertex_layout.bindings.size();
+	vertex_input_info.pVertexBindingDescriptions = _vertex_layout.bindings.data();
+	vertex_input_info.vertexAttributeDescriptionCount = _vertex_layout.attributes.size();
+	vertex_input_info.pVertexAttributeDescriptions = _vertex_layout.attributes.data();
 	info.pVertexInputState = &vertex_input_info;
 
 	VkPipelineColorBlendStateCreateInfo color_blend_info = {};
 	color_blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	color_blend_info.logicOpEnable = VK_FALSE;
 	color_blend_info.logicOp = VK_LOGIC_OP_COPY;
-	color_blend_info.attachmentCount = 1;
+	color_blend_info.attachmentCount = depth_only ? 0 : 1;
 
 	VkPipelineColorBlendAttachmentState blend_color_attachment = {};
 	blend_color_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -124,7 +270,7 @@ vk::GraphicsPipeline vk::PipelineBuilder::build()
 
 	VkPipelineInputAssemblyStateCreateInfo assembly_info = {};
 	assembly_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	assembly_info.primitiveRestartEnable = VK_FALSE;
+	assembly_info.primitiveRestartEnable = _index_restart ? VK_TRUE : VK_FALSE;
 	assembly_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
 	info.pInputAssemblyState = &assembly_info;
@@ -148,10 +294,9 @@ vk::GraphicsPipeline vk::PipelineBuilder::build()
 
 	VkPipelineDepthStencilStateCreateInfo depth_info = {};
 	depth_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	// Disable depth test for now. We'll probably want to turn this on at some later date.
-	depth_info.depthTestEnable = VK_FALSE;
-	depth_info.depthWriteEnable = VK_FALSE;
-	depth_info.depthCompareOp = VK_COMPARE_OP_NEVER;
+	depth_info.depthTestEnable = _depth_test ? VK_TRUE : VK_FALSE;
+	depth_info.depthWriteEnable = _depth_write ? VK_TRUE : VK_FALSE;
+	depth_info.depthCompareOp = _depth_compare_op;
 	depth_info.depthBoundsTestEnable = VK_FALSE;
 	depth_info.stencilTestEnable = VK_FALSE;
 	depth_info.front = {};
@@ -162,8 +307,8 @@ vk::GraphicsPipeline vk::PipelineBuilder::build()
 
 	VkPipelineRenderingCreateInfo render_info = {};
 	render_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-	render_info.colorAttachmentCount = 1;
-	render_info.pColorAttachmentFormats = &_color_format;
+	render_info.colorAttachmentCount = depth_only ? 0 : 1;
+	render_info.pColorAttachmentFormats = depth_only ? nullptr : &_color_format;
 	render_info.depthAttachmentFormat = _depth_format;
 	info.pNext = &render_info;
 
@@ -174,25 +319,77 @@ vk::GraphicsPipeline vk::PipelineBuilder::build()
 	dynamic_info.pDynamicStates = dynamic_states;
 	info.pDynamicState = &dynamic_info;
 
-	VkPipelineLayoutCreateInfo layout_info = {};
-	layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	// No descriptor sets or push constants yet, so don't initialize anything else.
-
-	VkPipelineLayout layout;
-	auto result = vkCreatePipelineLayout(_device.device(), &layout_info, nullptr, &layout);
-	vk_check(result);
 	info.layout = layout;
 
 	VkPipeline pipeline;
-	result = vkCreateGraphicsPipelines(_device.device(), VK_NULL_HANDLE, 1, &info, nullptr, &pipeline);
-	vk_check(result);
+	auto result = _device.dispatch().vkCreateGraphicsPipelines(_device.device(), VK_NULL_HANDLE, 1, &info, _device.allocation_callbacks(), &pipeline);
 
 	// We don't need the attached shaders anymore after the pipeline has been created.
-	vkDestroyShaderModule(_device.device(), _vertex_shader, nullptr);
-	vkDestroyShaderModule(_device.device(), _fragment_shader, nullptr);
+	_device.dispatch().vkDestroyShaderModule(_device.device(), vertex_shader, _device.allocation_callbacks());
+	if (fragment_shader != VK_NULL_HANDLE)
+	{
+		_device.dispatch().vkDestroyShaderModule(_device.device(), fragment_shader, _device.allocation_callbacks());
+	}
+
+	vk_check(result);
+
+	return pipeline;
+}
+
+vk::ComputePipelineBuilder::ComputePipelineBuilder(vk::Device& device) : _device(device)
+{
+
+}
+
+void vk::ComputePipelineBuilder::set_shader_from_file(std::string_view filename)
+{
+	_code = read_shader_file(filename);
+}
+
+void vk::ComputePipelineBuilder::set_layout(VkPipelineLayout layout)
+{
+	_layout = layout;
+}
+
+vk::Pipeline vk::ComputePipelineBuilder::build()
+{
+	if (_code.empty())
+	{
+		throw std::runtime_error("Compute shader must be set.");
+	}
+
+	VkPipelineLayout layout = _layout;
+	if (layout == VK_NULL_HANDLE)
+	{
+		layout = get_pipeline_layout(_device, VK_SHADER_STAGE_ALL, _push_constant_size);
+	}
+
+	CacheKey key;
+	key.add(static_cast<uint32_t>(VK_PIPELINE_BIND_POINT_COMPUTE));
+	key.add_words(_code);
+	key.add_handle(layout);
+
+	VkPipeline pipeline = _device.objects().pipeline(key, [&]() {
+		VkShaderModule shader = create_shader_module(_device, _code);
+
+		VkComputePipelineCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		info.stage = create_shader_stage_info(shader, VK_SHADER_STAGE_COMPUTE_BIT);
+		info.layout = layout;
+
+		VkPipeline created;
+		auto result = _device.dispatch().vkCreateComputePipelines(_device.device(), VK_NULL_HANDLE, 1, &info, _device.allocation_callbacks(), &created);
+		_device.dispatch().vkDestroyShaderModule(_device.device(), shader, _device.allocation_callbacks());
+		vk_check(result);
+
+		return created;
+	});
 
 	return {
 		pipeline,
-		layout
+		layout,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		_push_constant_size,
+		_push_constant_type
 	};
 }
\ No newline at end of file
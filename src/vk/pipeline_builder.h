@@ -1,37 +1,118 @@
 #pragma once
 
 #include <string_view>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
+#include "push_constants.h"
+
 namespace vk {
 
 	class Device;
 
-	struct GraphicsPipeline {
+	// The pipeline and layout belong to the device's ObjectCache, so there's nothing to destroy. Building the same
+	// thing twice gives back the same pipeline.
+	struct Pipeline {
 		VkPipeline pipeline;
 		VkPipelineLayout layout;
+		VkPipelineBindPoint bind_point;
+		// What set_push_constants declared, 0 and null if nothing. A raw set_push_constant_range only sets the size.
+		uint32_t push_constant_size;
+		PushConstantType push_constant_type;
+	};
+
+	struct VertexLayout {
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+
+		VertexLayout& binding(uint32_t binding, uint32_t stride, VkVertexInputRate rate = VK_VERTEX_INPUT_RATE_VERTEX);
+		VertexLayout& attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset);
 	};
 
 	class PipelineBuilder {
 	public:
 		PipelineBuilder(vk::Device& device);
 
-		GraphicsPipeline build();
+		Pipeline build();
 
 		void set_vertex_shader_from_file(std::string_view filename);
+		// Can be left out for depth only pipelines, which also leave the color format unset.
 		void set_fragment_shader_from_file(std::string_view filename);
 
 		void set_color_format(VkFormat format);
 		void set_depth_format(VkFormat format);
+		// Off unless set. Needs a depth format.
+		void set_depth_test(bool write, VkCompareOp compare_op);
+
+		// Leave this unset to pull vertices in the shader instead, e.g. through a buffer address in a push constant.
+		void set_vertex_layout(const VertexLayout& layout);
+		void set_index_restart(bool enabled);
+
+		void set_push_constant_range(VkShaderStageFlags stages, uint32_t size);
+
+		// Declares the per draw struct, which CommandBuffer::push then writes. Visible to every stage.
+		template <typename T>
+		void set_push_constants()
+		{
+			this->set_push_constant_range(VK_SHADER_STAGE_ALL, push_constant_size<T>());
+			_push_constant_type = push_constant_type<T>();
+		}
+
+		// Use an existing layout instead of asking the cache for one. Its push constant range has to cover whatever
+		// set_push_constants declared.
+		void set_layout(VkPipelineLayout layout);
 
 	private:
+		// Only called when the cache doesn't have it.
+		VkPipeline create_pipeline(VkPipelineLayout layout, bool depth_only);
+
 		vk::Device& _device;
 
-		VkShaderModule _vertex_shader = VK_NULL_HANDLE;
-		VkShaderModule _fragment_shader = VK_NULL_HANDLE;
+		// SPIR-V, only turned into modules when the pipeline isn't cached already.
+		std::vector<uint32_t> _vertex_code;
+		std::vector<uint32_t> _fragment_code;
 
 		VkFormat _color_format = VK_FORMAT_UNDEFINED;
 		VkFormat _depth_format = VK_FORMAT_UNDEFINED;
+		bool _depth_test = false;
+		bool _depth_write = false;
+		VkCompareOp _depth_compare_op = VK_COMPARE_OP_NEVER;
+
+		VertexLayout _vertex_layout;
+		bool _index_restart = false;
+
+		VkShaderStageFlags _push_constant_stages = 0;
+		uint32_t _push_constant_size = 0;
+		PushConstantType _push_constant_type = nullptr;
+
+		VkPipelineLayout _layout = VK_NULL_HANDLE;
+	};
+
+	class ComputePipelineBuilder {
+	public:
+		ComputePipelineBuilder(vk::Device& device);
+
+		Pipeline build();
+
+		void set_shader_from_file(std::string_view filename);
+
+		template <typename T>
+		void set_push_constants()
+		{
+			_push_constant_size = push_constant_size<T>();
+			_push_constant_type = push_constant_type<T>();
+		}
+
+		// Same as PipelineBuilder::set_layout.
+		void set_layout(VkPipelineLayout layout);
+
+	private:
+		vk::Device& _device;
+
+		std::vector<uint32_t> _code;
+		uint32_t _push_constant_size = 0;
+		PushConstantType _push_constant_type = nullptr;
+		VkPipelineLayout _layout = VK_NULL_HANDLE;
 	};
 }
\ No newline at end of file
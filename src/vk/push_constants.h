@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace vk {
+
+	// The spec only promises 128 bytes of push constants, so that's all anyone gets.
+	constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+	// Per draw data structs that fit go straight into push constants. Bigger ones get copied into frame memory,
+	// and the push constants just hold a VkDeviceAddress to them (a buffer_reference on the shader side).
+	template <typename T>
+	constexpr bool fits_in_push_constants = sizeof(T) <= MAX_PUSH_CONSTANT_SIZE;
+
+	// How many bytes of push constants T actually takes up.
+	template <typename T>
+	constexpr uint32_t push_constant_size()
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Push constant structs get memcpy'd to the GPU.");
+		return fits_in_push_constants<T> ? sizeof(T) : sizeof(VkDeviceAddress);
+	}
+
+	// Identifies a push constant struct, so CommandBuffer::push can tell it apart from another struct of the same size.
+	// Its address is what matters, and there's one per type.
+	template <typename T>
+	inline constexpr char push_constant_tag = 0;
+
+	using PushConstantType = const void*;
+
+	template <typename T>
+	constexpr PushConstantType push_constant_type()
+	{
+		return &push_constant_tag<T>;
+	}
+
+}
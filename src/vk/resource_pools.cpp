@@ -0,0 +1,87 @@
+#include "resource_pools.h"
+
+#include "device.h"
+#include "sampler_cache.h"
+
+vk::ResourcePools::ResourcePools(vk::Device& device) :
+	_device(device),
+	_buffers("Buffer", MAX_BUFFERS),
+	_images("Image", MAX_IMAGES),
+	_pipelines("Pipeline", MAX_PIPELINES),
+	_samplers("Sampler", MAX_SAMPLERS)
+{
+}
+
+void vk::ResourcePools::destroy()
+{
+	vk::DeletionQueue& deletion_queue = _device.deletion_queue();
+
+	for (vk::Buffer& buffer : _buffers.remove_all())
+	{
+		deletion_queue.retire(std::move(buffer));
+	}
+	for (vk::Image& image : _images.remove_all())
+	{
+		deletion_queue.retire(std::move(image));
+	}
+	// Pipelines belong to the object cache.
+	_pipelines.remove_all();
+	for (const PooledSampler& sampler : _samplers.remove_all())
+	{
+		this->retire(sampler);
+	}
+}
+
+vk::BufferHandle vk::ResourcePools::add(vk::Buffer&& buffer)
+{
+	return _buffers.add(std::move(buffer));
+}
+
+vk::ImageHandle vk::ResourcePools::add(vk::Image&& image)
+{
+	return _images.add(std::move(image));
+}
+
+vk::PipelineHandle vk::ResourcePools::add(const vk::Pipeline& pipeline)
+{
+	return _pipelines.add(vk::Pipeline(pipeline));
+}
+
+vk::SamplerHandle vk::ResourcePools::add_sampler(const VkSamplerCreateInfo& info)
+{
+	PooledSampler sampler = {};
+	sampler.sampler = _device.samplers().get(info);
+	sampler.bindless = _device.bindless().add_sampler(sampler.sampler);
+
+	return _samplers.add(std::move(sampler));
+}
+
+void vk::ResourcePools::remove(BufferHandle handle)
+{
+	_device.deletion_queue().retire(_buffers.remove(handle));
+}
+
+void vk::ResourcePools::remove(ImageHandle handle)
+{
+	_device.deletion_queue().retire(_images.remove(handle));
+}
+
+void vk::ResourcePools::remove(PipelineHandle handle)
+{
+	// Only the handle goes, the pipeline belongs to the object cache.
+	_pipelines.remove(handle);
+}
+
+void vk::ResourcePools::remove(SamplerHandle handle)
+{
+	this->retire(_samplers.remove(handle));
+}
+
+void vk::ResourcePools::retire(PooledSampler sampler)
+{
+	// The sampler itself belongs to the cache, only the bindless slot is ours. It gets handed out again as soon as
+	// it's freed, so that has to wait for the GPU too.
+	vk::Device& device = _device;
+	BindlessIndex index = sampler.bindless;
+	_device.deletion_queue().retire([&device, index]() { device.bindless().remove_sampler(index); });
+}
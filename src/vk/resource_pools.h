@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+#include "core/handle_pool.h"
+#include "bindless.h"
+#include "buffer.h"
+#include "image.h"
+#include "pipeline_builder.h"
+
+namespace vk {
+
+	class Device;
+
+	struct BufferTag;
+	struct ImageTag;
+	struct PipelineTag;
+	struct SamplerTag;
+
+	using BufferHandle = core::Handle<BufferTag>;
+	using ImageHandle = core::Handle<ImageTag>;
+	using PipelineHandle = core::Handle<PipelineTag>;
+	using SamplerHandle = core::Handle<SamplerTag>;
+
+	// Buffers, images, pipelines and samplers owned by the device instead of whoever made them, and referred to by
+	// 32 bit handles. Handles are plain values, so they can be handed to other threads or stored anywhere an index
+	// could, and using one after its resource is gone throws rather than touching something that's been destroyed.
+	// Removing retires the resource through the deletion queue, so nobody has to wait for the GPU to be done with it.
+	class ResourcePools {
+	public:
+		static constexpr uint32_t MAX_BUFFERS = 16384;
+		static constexpr uint32_t MAX_IMAGES = 16384;
+		static constexpr uint32_t MAX_PIPELINES = 1024;
+		static constexpr uint32_t MAX_SAMPLERS = BindlessHeap::MAX_SAMPLERS;
+
+		ResourcePools(vk::Device& device);
+		// Retires whatever's left, so the deletion queue has to be destroyed afterwards.
+		void destroy();
+
+		ResourcePools& operator=(const ResourcePools& other) = delete;
+		ResourcePools(const ResourcePools& other) = delete;
+
+		BufferHandle add(vk::Buffer&& buffer);
+		ImageHandle add(vk::Image&& image);
+		PipelineHandle add(const vk::Pipeline& pipeline);
+		// Through the device's sampler cache, and into the bindless heap.
+		SamplerHandle add_sampler(const VkSamplerCreateInfo& info);
+
+		// References are good until the handle is removed.
+		vk::Buffer& get(BufferHandle handle) { return _buffers.get(handle); }
+		vk::Image& get(ImageHandle handle) { return _images.get(handle); }
+		const vk::Pipeline& get(PipelineHandle handle) { return _pipelines.get(handle); }
+		VkSampler get(SamplerHandle handle) { return _samplers.get(handle).sampler; }
+		BindlessIndex bindless_index(SamplerHandle handle) { return _samplers.get(handle).bindless; }
+
+		void remove(BufferHandle handle);
+		void remove(ImageHandle handle);
+		void remove(PipelineHandle handle);
+		void remove(SamplerHandle handle);
+
+	private:
+		struct PooledSampler {
+			VkSampler sampler;
+			BindlessIndex bindless;
+		};
+
+		void retire(PooledSampler sampler);
+
+		vk::Device& _device;
+
+		core::HandlePool<vk::Buffer, BufferTag> _buffers;
+		core::HandlePool<vk::Image, ImageTag> _images;
+		core::HandlePool<vk::Pipeline, PipelineTag> _pipelines;
+		core::HandlePool<PooledSampler, SamplerTag> _samplers;
+	};
+
+}
@@ -0,0 +1,105 @@
+#include "sampler_cache.h"
+
+#include <bit>
+#include <stdexcept>
+
+#include "device.h"
+#include "object_cache.h"
+#include "vulkan_error.h"
+
+VkSamplerCreateInfo vk::sampler_info(vk::Device& device, VkFilter filter, VkSamplerAddressMode address_mode)
+{
+	VkSamplerCreateInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	info.magFilter = filter;
+	info.minFilter = filter;
+	info.mipmapMode = filter == VK_FILTER_NEAREST ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	info.addressModeU = address_mode;
+	info.addressModeV = address_mode;
+	info.addressModeW = address_mode;
+	info.minLod = 0.0f;
+	info.maxLod = VK_LOD_CLAMP_NONE;
+	info.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+	if (device.anisotropy_enabled())
+	{
+		info.anisotropyEnable = VK_TRUE;
+		info.maxAnisotropy = device.max_anisotropy();
+	}
+
+	return info;
+}
+
+vk::SamplerCache::SamplerCache(vk::Device& device) : _device(device)
+{
+}
+
+void vk::SamplerCache::destroy()
+{
+	std::scoped_lock lock(_mutex);
+
+	for (auto& [key, sampler] : _samplers)
+	{
+		_device.dispatch().vkDestroySampler(_device.device(), sampler, _device.allocation_callbacks());
+	}
+	_samplers.clear();
+}
+
+VkSampler vk::SamplerCache::get(const VkSamplerCreateInfo& info)
+{
+	if (info.pNext != nullptr)
+	{
+		throw std::runtime_error("SamplerCache can't cache chained sampler create infos.");
+	}
+
+	Key key = make_key(info);
+
+	std::scoped_lock lock(_mutex);
+
+	auto it = _samplers.find(key);
+	if (it != _samplers.end())
+	{
+		return it->second;
+	}
+
+	VkSampler sampler;
+	auto result = _device.dispatch().vkCreateSampler(_device.device(), &info, _device.allocation_callbacks(), &sampler);
+	vk_check(result);
+
+	_samplers.emplace(key, sampler);
+
+	return sampler;
+}
+
+size_t vk::SamplerCache::size()
+{
+	std::scoped_lock lock(_mutex);
+	return _samplers.size();
+}
+
+vk::SamplerCache::Key vk::SamplerCache::make_key(const VkSamplerCreateInfo& info)
+{
+	return {
+		info.flags,
+		static_cast<uint32_t>(info.magFilter),
+		static_cast<uint32_t>(info.minFilter),
+		static_cast<uint32_t>(info.mipmapMode),
+		static_cast<uint32_t>(info.addressModeU),
+		static_cast<uint32_t>(info.addressModeV),
+		static_cast<uint32_t>(info.addressModeW),
+		std::bit_cast<uint32_t>(info.mipLodBias),
+		info.anisotropyEnable,
+		std::bit_cast<uint32_t>(info.maxAnisotropy),
+		info.compareEnable,
+		static_cast<uint32_t>(info.compareOp),
+		std::bit_cast<uint32_t>(info.minLod),
+		std::bit_cast<uint32_t>(info.maxLod),
+		static_cast<uint32_t>(info.borderColor),
+		info.unnormalizedCoordinates,
+	};
+}
+
+size_t vk::SamplerCache::KeyHash::operator()(const Key& key) const
+{
+	return hash_words(key);
+}
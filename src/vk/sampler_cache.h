@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace vk {
+
+	class Device;
+
+	// Trilinear filtering over the whole mip chain, with anisotropy if the device enabled it.
+	VkSamplerCreateInfo sampler_info(vk::Device& device, VkFilter filter, VkSamplerAddressMode address_mode);
+
+	// Samplers are tiny but the device only gets so many of them (maxSamplerAllocationCount can be as low as 4000),
+	// so identical create infos share one sampler. Owned by the device, everything is destroyed with it.
+	class SamplerCache {
+	public:
+		SamplerCache(vk::Device& device);
+		void destroy();
+
+		SamplerCache& operator=(const SamplerCache& other) = delete;
+		SamplerCache(const SamplerCache& other) = delete;
+
+		// Chained create infos (reduction modes, YCbCr conversion) aren't supported.
+		VkSampler get(const VkSamplerCreateInfo& info);
+
+		size_t size();
+
+	private:
+		// Every field of VkSamplerCreateInfo after pNext, with floats as their bit patterns so equality and hashing agree.
+		using Key = std::array<uint32_t, 16>;
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		static Key make_key(const VkSamplerCreateInfo& info);
+
+		vk::Device& _device;
+
+		std::mutex _mutex;
+		std::unordered_map<Key, VkSampler, KeyHash> _samplers;
+	};
+
+}
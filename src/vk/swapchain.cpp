@@ -5,6 +5,7 @@
 #include <algorithm>
 
 #include "vk/context.h"
+#include "vk/image.h"
 #include "vk/vulkan_error.h"
 #include "vk/sync.h"
 #include "window/window.h"
@@ -57,21 +58,24 @@ vk::Swapchain::Swapchain(vk::Context &context, Window &window) : _context(contex
     info.imageArrayLayers = 1;
     info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
-    auto result = vkCreateSwapchainKHR(_context.vk_device(), &info, nullptr, &_swapchain);
+    auto result = _context.device().dispatch().vkCreateSwapchainKHR(_context.vk_device(), &info, _context.allocation_callbacks(), &_swapchain);
     vk_check(result);
 
     uint32_t image_count;
-    result = vkGetSwapchainImagesKHR(_context.vk_device(), _swapchain, &image_count, nullptr);
+    result = _context.device().dispatch().vkGetSwapchainImagesKHR(_context.vk_device(), _swapchain, &image_count, nullptr);
     vk_check(result);
 
     _images.resize(image_count);
-    result = vkGetSwapchainImagesKHR(_context.vk_device(), _swapchain, &image_count, _images.data());
+    result = _context.device().dispatch().vkGetSwapchainImagesKHR(_context.vk_device(), _swapchain, &image_count, _images.data());
     vk_check(result);
 
     _image_views.resize(image_count);
     for (int i = 0; i < image_count; i++)
     {
-        _image_views[i] = this->create_image_view(_images[i]);
+        VkImageSubresourceRange range = vk::get_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
+        range.levelCount = 1;
+        range.layerCount = 1;
+        _image_views[i] = vk::create_image_view(_context.device(), _images[i], _surface_format, range);
     }
 }
 
@@ -79,16 +83,16 @@ void vk::Swapchain::destroy()
 {
     for (auto view : _image_views)
     {
-        vkDestroyImageView(_context.vk_device(), view, nullptr);
+        _context.device().dispatch().vkDestroyImageView(_context.vk_device(), view, _context.allocation_callbacks());
     }
 
-    vkDestroySwapchainKHR(_context.vk_device(), _swapchain, nullptr);
+    _context.device().dispatch().vkDestroySwapchainKHR(_context.vk_device(), _swapchain, _context.allocation_callbacks());
 }
 
 uint32_t vk::Swapchain::acquire_image(vk::Semaphore& completion)
 {
     uint32_t image_idx;
-    auto result = vkAcquireNextImageKHR(_context.vk_device(), _swapchain, 1000000000, completion.vk_semaphore(), nullptr, &image_idx);
+    auto result = _context.device().dispatch().vkAcquireNextImageKHR(_context.vk_device(), _swapchain, 1000000000, completion.vk_semaphore(), nullptr, &image_idx);
     vk_check(result);
 
     return image_idx;
@@ -118,7 +122,7 @@ void vk::Swapchain::present(uint32_t idx, VkQueue queue, vk::Semaphore& completi
 
     present_info.pImageIndices = &idx;
 
-    auto result = vkQueuePresentKHR(queue, &present_info);
+    auto result = _context.device().dispatch().vkQueuePresentKHR(queue, &present_info);
     vk_check(result);
 }
 
@@ -177,31 +181,4 @@ VkExtent2D vk::Swapchain::choose_swap_extent(Window &window)
 
     // Otherwise, we just return whatever we're given.
     return caps.currentExtent;
-}
-
-VkImageView vk::Swapchain::create_image_view(VkImage image)
-{
-    VkImageViewCreateInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    info.image = image;
-
-    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    info.format = _surface_format;
-
-    info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-    info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    info.subresourceRange.baseMipLevel = 0;
-    info.subresourceRange.levelCount = 1;
-    info.subresourceRange.baseArrayLayer = 0;
-    info.subresourceRange.layerCount = 1;
-
-    VkImageView view;
-    auto result = vkCreateImageView(_context.vk_device(), &info, nullptr, &view);
-    vk_check(result);
-
-    return view;
 }
\ No newline at end of file
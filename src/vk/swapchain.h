@@ -42,8 +42,6 @@ namespace vk {
 		VkSurfaceFormatKHR select_format();
 		VkPresentModeKHR select_present_mode();
 		VkExtent2D choose_swap_extent(Window &window);
-
-		VkImageView create_image_view(VkImage image);
 	};
 
 }
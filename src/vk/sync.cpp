@@ -10,13 +10,13 @@ vk::Semaphore::Semaphore(vk::Device& device, VkSemaphoreCreateFlags flags) : _de
 
     info.flags = flags;
 
-    auto result = vkCreateSemaphore(device.device(), &info, nullptr, &_semaphore);
+    auto result = _device.dispatch().vkCreateSemaphore(device.device(), &info, _device.allocation_callbacks(), &_semaphore);
     vk_check(result);
 }
 
 vk::Semaphore::~Semaphore()
 {
-    vkDestroySemaphore(_device.device(), _semaphore, nullptr);
+    _device.dispatch().vkDestroySemaphore(_device.device(), _semaphore, _device.allocation_callbacks());
 }
 
 VkSemaphoreSubmitInfo vk::Semaphore::submit_info(VkPipelineStageFlags2 stages)
@@ -33,29 +33,84 @@ VkSemaphoreSubmitInfo vk::Semaphore::submit_info(VkPipelineStageFlags2 stages)
     return info;
 }
 
+vk::TimelineSemaphore::TimelineSemaphore(vk::Device& device, uint64_t initial_value) : _device(device)
+{
+    VkSemaphoreTypeCreateInfo type_info = {};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = initial_value;
+
+    VkSemaphoreCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    info.pNext = &type_info;
+
+    auto result = _device.dispatch().vkCreateSemaphore(_device.device(), &info, _device.allocation_callbacks(), &_semaphore);
+    vk_check(result);
+}
+
+vk::TimelineSemaphore::~TimelineSemaphore()
+{
+    _device.dispatch().vkDestroySemaphore(_device.device(), _semaphore, _device.allocation_callbacks());
+}
+
+VkSemaphoreSubmitInfo vk::TimelineSemaphore::submit_info(VkPipelineStageFlags2 stages, uint64_t value)
+{
+    VkSemaphoreSubmitInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+
+    info.semaphore = _semaphore;
+    info.stageMask = stages;
+
+    info.deviceIndex = 0;
+    info.value = value;
+
+    return info;
+}
+
+uint64_t vk::TimelineSemaphore::completed()
+{
+    uint64_t value = 0;
+    auto result = _device.dispatch().vkGetSemaphoreCounterValue(_device.device(), _semaphore, &value);
+    vk_check(result);
+
+    return value;
+}
+
+void vk::TimelineSemaphore::wait(uint64_t value, uint64_t timeout_ns)
+{
+    VkSemaphoreWaitInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    info.semaphoreCount = 1;
+    info.pSemaphores = &_semaphore;
+    info.pValues = &value;
+
+    auto result = _device.dispatch().vkWaitSemaphores(_device.device(), &info, timeout_ns);
+    vk_check(result);
+}
+
 vk::Fence::Fence(vk::Device& device, VkFenceCreateFlags flags) : _device(device)
 {
     VkFenceCreateInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     info.flags = flags;
 
-    auto result = vkCreateFence(_device.device(), &info, nullptr, &_fence);
+    auto result = _device.dispatch().vkCreateFence(_device.device(), &info, _device.allocation_callbacks(), &_fence);
     vk_check(result);
 }
 
 vk::Fence::~Fence()
 {
-    vkDestroyFence(_device.device(), _fence, nullptr);
+    _device.dispatch().vkDestroyFence(_device.device(), _fence, _device.allocation_callbacks());
 }
 
 void vk::Fence::wait(uint64_t timeout_ns)
 {
-    auto result = vkWaitForFences(_device.device(), 1, &_fence, true, timeout_ns);
+    auto result = _device.dispatch().vkWaitForFences(_device.device(), 1, &_fence, true, timeout_ns);
     vk_check(result);
 }
 
 void vk::Fence::reset()
 {
-    auto result = vkResetFences(_device.device(), 1, &_fence);
+    auto result = _device.dispatch().vkResetFences(_device.device(), 1, &_fence);
     vk_check(result);
 }
\ No newline at end of file
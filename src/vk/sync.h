@@ -22,6 +22,28 @@ private:
 	VkSemaphore _semaphore;
 };
 
+// Counts up instead of flipping between signaled and unsignaled, so one semaphore can say how far the GPU has got.
+class TimelineSemaphore {
+public:
+	TimelineSemaphore(vk::Device& device, uint64_t initial_value = 0);
+	~TimelineSemaphore();
+
+	TimelineSemaphore& operator=(const TimelineSemaphore& other) = delete;
+	TimelineSemaphore(const TimelineSemaphore& other) = delete;
+
+	VkSemaphore vk_semaphore() { return _semaphore; }
+	// For a submit to signal or wait on value.
+	VkSemaphoreSubmitInfo submit_info(VkPipelineStageFlags2 stages, uint64_t value);
+
+	// The last value signaled. Doesn't block.
+	uint64_t completed();
+	void wait(uint64_t value, uint64_t timeout_ns);
+
+private:
+	vk::Device& _device;
+	VkSemaphore _semaphore;
+};
+
 class Fence {
 public:
 	Fence(vk::Device& device, VkFenceCreateFlags flags);
@@ -0,0 +1,200 @@
+#include "uploader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "device.h"
+#include "vulkan_error.h"
+
+const uint64_t UPLOAD_TIMEOUT_NS = 10000000000;
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+vk::Uploader::Uploader(vk::Device& device, VkDeviceSize staging_size) :
+	_device(device),
+	_pool(device.alloc_transfer_pool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT)),
+	_cmd(device, _pool),
+	_graphics_pool(device.alloc_graphics_pool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT)),
+	_graphics_cmd(device, _graphics_pool),
+	_transfer_done(device, 0),
+	_fence(device, 0),
+	_staging(device, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, vk::MemoryUsage::CpuToGpu)
+{
+}
+
+vk::Uploader::~Uploader()
+{
+	_device.dispatch().vkDestroyCommandPool(_device.device(), _pool, _device.allocation_callbacks());
+	_device.dispatch().vkDestroyCommandPool(_device.device(), _graphics_pool, _device.allocation_callbacks());
+}
+
+VkDeviceSize vk::Uploader::reserve_staging(VkDeviceSize& size)
+{
+	VkDeviceSize offset = (_staging_used + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	if (offset >= _staging.size())
+	{
+		this->flush();
+		offset = 0;
+	}
+
+	size = std::min(size, _staging.size() - offset);
+	_staging_used = offset + size;
+
+	return offset;
+}
+
+void vk::Uploader::upload(vk::Buffer& dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size)
+{
+	const char* src = static_cast<const char*>(data);
+
+	// Anything bigger than the staging buffer goes up in pieces.
+	while (size > 0)
+	{
+		VkDeviceSize chunk = size;
+		VkDeviceSize staging_offset = this->reserve_staging(chunk);
+
+		_staging.write(src, chunk, staging_offset);
+		_buffer_copies.push_back({ &dst, staging_offset, dst_offset, chunk });
+
+		src += chunk;
+		dst_offset += chunk;
+		size -= chunk;
+	}
+}
+
+void vk::Uploader::upload(vk::Image& dst, const void* data, VkDeviceSize size)
+{
+	// Splitting an image copy up by rows isn't worth it yet.
+	if (size > _staging.size())
+	{
+		throw std::runtime_error(fmt::format("Image upload of {} bytes doesn't fit in the {} byte staging buffer.", size, _staging.size()));
+	}
+
+	VkDeviceSize reserved = size;
+	VkDeviceSize staging_offset = this->reserve_staging(reserved);
+	if (reserved < size)
+	{
+		// Only the tail of the staging buffer was free, start over at the front.
+		this->flush();
+		reserved = size;
+		staging_offset = this->reserve_staging(reserved);
+	}
+
+	_staging.write(data, size, staging_offset);
+	_image_copies.push_back({ &dst, staging_offset });
+}
+
+void vk::Uploader::flush()
+{
+	if (_buffer_copies.empty() && _image_copies.empty())
+	{
+		_staging_used = 0;
+		return;
+	}
+
+	_cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	for (auto& copy : _buffer_copies)
+	{
+		_cmd.copy_buffer(_staging, *copy.dst, copy.staging_offset, copy.dst_offset, copy.size);
+	}
+
+	ImageBarrierState undefined_state = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+	ImageBarrierState copy_state = { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+
+	for (auto& copy : _image_copies)
+	{
+		vk::Image& image = *copy.dst;
+		transition_image(_cmd, image.image(), image.range(), undefined_state, copy_state);
+
+		VkBufferImageCopy2 region = {};
+		region.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+		region.bufferOffset = copy.staging_offset;
+		region.imageSubresource = { image.aspect(), 0, 0, 1 };
+		region.imageExtent = { image.extent().width, image.extent().height, 1 };
+
+		VkCopyBufferToImageInfo2 info = {};
+		info.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2;
+		info.srcBuffer = _staging.buffer();
+		info.dstImage = image.image();
+		info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		info.regionCount = 1;
+		info.pRegions = &region;
+
+		_cmd.dispatch().vkCmdCopyBufferToImage2(_cmd.buffer(), &info);
+	}
+
+	_cmd.end();
+
+	VkCommandBufferSubmitInfo buffer_submit = _cmd.submit_info();
+	VkSemaphoreSubmitInfo transfer_signal = _transfer_done.submit_info(VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT);
+
+	VkSubmitInfo2 submit = {};
+	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit.commandBufferInfoCount = 1;
+	submit.pCommandBufferInfos = &buffer_submit;
+
+	bool has_images = !_image_copies.empty();
+	if (has_images)
+	{
+		submit.signalSemaphoreInfoCount = 1;
+		submit.pSignalSemaphoreInfos = &transfer_signal;
+	}
+
+	// With images in the batch, the fence goes on the frame queue submit, which can't finish before this one does.
+	auto result = _device.dispatch().vkQueueSubmit2(_device.queue(vk::QueueRole::Streaming), 1, &submit, has_images ? VK_NULL_HANDLE : _fence.vk_fence());
+	vk_check(result);
+
+	if (has_images)
+	{
+		this->finish_images();
+	}
+
+	_fence.wait(UPLOAD_TIMEOUT_NS);
+	_fence.reset();
+
+	_buffer_copies.clear();
+	_image_copies.clear();
+	_staging_used = 0;
+}
+
+void vk::Uploader::finish_images()
+{
+	_graphics_cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	ImageBarrierState copy_state = { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+	ImageBarrierState read_state = {
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+	};
+
+	for (auto& copy : _image_copies)
+	{
+		vk::Image& image = *copy.dst;
+		if (image.mip_levels() > 1)
+		{
+			image.generate_mips(_graphics_cmd, read_state);
+		}
+		else
+		{
+			transition_image(_graphics_cmd, image.image(), image.range(), copy_state, read_state);
+		}
+	}
+
+	_graphics_cmd.end();
+
+	VkCommandBufferSubmitInfo buffer_submit = _graphics_cmd.submit_info();
+	VkSemaphoreSubmitInfo transfer_wait = _transfer_done.submit_info(VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT);
+
+	VkSubmitInfo2 submit = {};
+	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit.waitSemaphoreInfoCount = 1;
+	submit.pWaitSemaphoreInfos = &transfer_wait;
+	submit.commandBufferInfoCount = 1;
+	submit.pCommandBufferInfos = &buffer_submit;
+
+	auto result = _device.dispatch().vkQueueSubmit2(_device.queue(vk::QueueRole::Frame), 1, &submit, _fence.vk_fence());
+	vk_check(result);
+}
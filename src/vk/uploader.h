@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "buffer.h"
+#include "command_buffer.h"
+#include "image.h"
+#include "sync.h"
+
+namespace vk {
+
+	class Device;
+
+	// Gets data into GPU only resources through a staging buffer, on the streaming queue.
+	// Uploads are batched up until flush(), which submits them all at once and waits for them to land.
+	// Images need layout transitions and mip blits the streaming queue may not be able to do, so those finish off on the frame queue.
+	class Uploader {
+	public:
+		static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 16 * 1024 * 1024;
+
+		Uploader(vk::Device& device, VkDeviceSize staging_size = DEFAULT_STAGING_SIZE);
+		~Uploader();
+
+		Uploader& operator=(const Uploader& other) = delete;
+		Uploader(const Uploader& other) = delete;
+
+		// Data is copied out immediately, so it doesn't have to outlive the call.
+		void upload(vk::Buffer& dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+
+		// Data is the tightly packed top level. The rest of the chain is generated from it if the image has more than one mip.
+		// The image ends up SHADER_READ_ONLY_OPTIMAL.
+		void upload(vk::Image& dst, const void* data, VkDeviceSize size);
+
+		void flush();
+
+	private:
+		struct BufferCopy {
+			vk::Buffer* dst;
+			VkDeviceSize staging_offset;
+			VkDeviceSize dst_offset;
+			VkDeviceSize size;
+		};
+
+		struct ImageCopy {
+			vk::Image* dst;
+			VkDeviceSize staging_offset;
+		};
+
+		// Returns where in the staging buffer the next size bytes (or as many as fit) can go, flushing if it's full.
+		VkDeviceSize reserve_staging(VkDeviceSize& size);
+
+		// Layout transitions and mips for this batch's images, on the frame queue once the copies are done.
+		void finish_images();
+
+		vk::Device& _device;
+		VkCommandPool _pool;
+		vk::CommandBuffer _cmd;
+		VkCommandPool _graphics_pool;
+		vk::CommandBuffer _graphics_cmd;
+		vk::Semaphore _transfer_done;
+		vk::Fence _fence;
+
+		vk::Buffer _staging;
+		VkDeviceSize _staging_used = 0;
+
+		std::vector<BufferCopy> _buffer_copies;
+		std::vector<ImageCopy> _image_copies;
+	};
+
+}
@@ -1,189 +1,144 @@
 #include "window.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#include <cmath>
-
+#include "core/triple_buffer.h"
 #include "vk/context.h"
-#include "vk/pipeline_builder.h"
-#include "vk/command_buffer.h"
-#include "vk/vulkan_error.h"
-#include "vk/sync.h"
-#include "vk/image.h"
-
-Window::Window(int width, int height, std::string_view title) : width(width), height(height), title(title)
-{
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    this->window = glfwCreateWindow(width, height, this->title.c_str(), nullptr, nullptr);
+#include "render/renderer.h"
+#include "sim/simulation.h"
 
-    this->context.emplace("ugo-vk", *this);
-}
+// Longest stretch of real time one advance catches up on, so a stall (a breakpoint, dragging the window) doesn't
+// come back as a burst of steps.
+const double MAX_ADVANCE_SECONDS = 0.25;
 
-VkImageSubresourceRange get_image_range(VkImageAspectFlags flags)
+sim::Input read_input(GLFWwindow* window)
 {
-    VkImageSubresourceRange subresource = {};
-    // Update this when we support depth buffers.
-    subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    subresource.baseArrayLayer = 0;
-    subresource.baseMipLevel = 0;
-    subresource.layerCount = VK_REMAINING_ARRAY_LAYERS;
-    subresource.levelCount = VK_REMAINING_MIP_LEVELS;
-    
-    return subresource;
+    sim::Input input;
+    input.orbit_left = glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS;
+    input.orbit_right = glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+    input.zoom_in = glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS;
+    input.zoom_out = glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS;
+    input.pause = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+
+    return input;
 }
 
-VkRenderingAttachmentInfo create_color_attachment_info(VkImageView view, std::optional<VkClearValue> clear, VkImageLayout layout)
-{
-    VkRenderingAttachmentInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-
-    info.imageView = view;
-    info.imageLayout = layout;
+// Steps the simulation along with real time. Has to be used on the main thread, it reads input.
+struct SimulationClock {
+    sim::Simulation simulation;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    double accumulator = 0.0;
 
-    if (clear.has_value()) {
-        info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        info.clearValue = clear.value();
-    }
-    else {
-        info.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    // Runs every step that's come due, and returns where things are between the last two.
+    sim::Snapshot advance(GLFWwindow* window)
+    {
+        auto now = std::chrono::steady_clock::now();
+        accumulator += std::min(std::chrono::duration<double>(now - last).count(), MAX_ADVANCE_SECONDS);
+        last = now;
+
+        sim::Input input = read_input(window);
+        while (accumulator >= sim::Simulation::STEP)
+        {
+            simulation.step(input);
+            accumulator -= sim::Simulation::STEP;
+        }
+
+        return simulation.snapshot(static_cast<float>(accumulator / sim::Simulation::STEP));
     }
 
-    info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-    return info;
-}
+    double until_next_step() { return sim::Simulation::STEP - accumulator; }
+};
 
-VkSubmitInfo2 create_submit_info(VkCommandBufferSubmitInfo* buffer_submit, VkSemaphoreSubmitInfo* wait, VkSemaphoreSubmitInfo* signal)
+Window::Window(int width, int height, std::string_view title, vk::ContextOptions options) : width(width), height(height), title(title)
 {
-    VkSubmitInfo2 info = {};
-    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-
-    info.commandBufferInfoCount = 1;
-    info.pCommandBufferInfos = buffer_submit;
-
-    info.waitSemaphoreInfoCount = 1;
-    info.pWaitSemaphoreInfos = wait;
-
-    info.signalSemaphoreInfoCount = 1;
-    info.pSignalSemaphoreInfos = signal;
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    this->window = glfwCreateWindow(width, height, this->title.c_str(), nullptr, nullptr);
 
-    return info;
+    this->context.emplace("ugo-vk", *this, options);
 }
 
-const uint64_t ONE_SEC_NS = 1000000000;
-
-void Window::run()
+void Window::run(ThreadingMode mode)
 {
-    vk::Device& device = this->context.value().device();
-
-    vk::PipelineBuilder builder(device);
-    builder.set_vertex_shader_from_file("shader/tri.vert.spv");
-    builder.set_fragment_shader_from_file("shader/tri.frag.spv");
-    builder.set_color_format(this->context.value().swapchain().surface_format());
-    builder.set_depth_format(VK_FORMAT_UNDEFINED);
-
-    vk::GraphicsPipeline pipeline = builder.build();
-
-    VkCommandPool command_pool = device.alloc_graphics_pool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-    vk::CommandBuffer cmd(device.device(), command_pool);
-
-    vk::Fence render_fence(device, VK_FENCE_CREATE_SIGNALED_BIT);
-    vk::Semaphore swap_acquired(device, 0);
-    vk::Semaphore render_complete(device, 0);
-
-    uint64_t frame_idx = 0;
-
-    vk::ImageBarrierState swapchain_image_state = {};
-    swapchain_image_state.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    swapchain_image_state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
-    swapchain_image_state.access = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    render::Renderer renderer(this->context.value());
 
-    vk::ImageBarrierState render_image_state = {};
-    render_image_state.stage = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-    render_image_state.layout = VK_IMAGE_LAYOUT_GENERAL;
-    render_image_state.access = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
-
-    vk::ImageBarrierState present_image_state = {};
-    present_image_state.stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    present_image_state.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    present_image_state.access = 0;
+    if (mode == ThreadingMode::RenderThread)
+    {
+        this->run_render_thread(renderer);
+    }
+    else
+    {
+        this->run_single_threaded(renderer);
+    }
+}
 
-    VkImageSubresourceRange image_range = vk::get_image_range(VK_IMAGE_ASPECT_COLOR_BIT);
+void Window::run_single_threaded(render::Renderer& renderer)
+{
+    SimulationClock clock;
 
     while (!glfwWindowShouldClose(this->window))
     {
         glfwPollEvents();
 
-        render_fence.wait(ONE_SEC_NS);
-        render_fence.reset();
-
-        cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-        uint32_t swap_image_idx = this->context.value().swapchain().acquire_image(swap_acquired);
-        VkImage swap_image = this->context.value().swapchain().get_swapchain_image(swap_image_idx);
-        VkImageView swap_image_view = this->context.value().swapchain().get_swapchain_image_view(swap_image_idx);
-
-        vk::transition_image(cmd.buffer(), swap_image, image_range, swapchain_image_state, render_image_state);
-
-        VkClearColorValue clear_color;
-        clear_color = { {1.0f, (float)std::abs(std::sin((double)frame_idx / 10)), 1.0f, 1.0f} };
-        
-        VkRenderingAttachmentInfo color_attachment_info = create_color_attachment_info(swap_image_view, VkClearValue { clear_color }, render_image_state.layout);
-        VkRenderingInfo rendering_info = {};
-        rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-        
-        rendering_info.colorAttachmentCount = 1;
-        rendering_info.pColorAttachments = &color_attachment_info;
-        rendering_info.layerCount = 1;
-        rendering_info.renderArea.extent = this->context.value().swapchain().get_swap_extent();
-        rendering_info.renderArea.offset = { 0, 0 };
-
-        vkCmdBeginRendering(cmd.buffer(), &rendering_info);
-
-        vkCmdBindPipeline(cmd.buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
-
-        VkViewport viewport;
-        viewport.x = 0;
-        viewport.y = 0;
-        viewport.width = this->width;
-        viewport.height = this->height;
-        viewport.maxDepth = 1.0f;
-        viewport.minDepth = 0.0f;
-        vkCmdSetViewport(cmd.buffer(), 0, 1, &viewport);
-
-        VkRect2D scissor = rendering_info.renderArea;
-        vkCmdSetScissor(cmd.buffer(), 0, 1, &scissor);
-
-        vkCmdDraw(cmd.buffer(), 3, 1, 0, 0);
-
-        vkCmdEndRendering(cmd.buffer());
-
-        vk::transition_image(cmd.buffer(), swap_image, image_range, render_image_state, present_image_state);
-
-        cmd.end();
+        renderer.draw_frame(clock.advance(this->window));
+    }
+}
 
-        VkSemaphoreSubmitInfo wait_submit = swap_acquired.submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-        VkSemaphoreSubmitInfo signal_submit = render_complete.submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
-        VkCommandBufferSubmitInfo buffer_submit_info = cmd.submit_info();
+void Window::run_render_thread(render::Renderer& renderer)
+{
+    SimulationClock clock;
+    core::TripleBuffer<sim::Snapshot> snapshots;
 
-        VkSubmitInfo2 submit_info = create_submit_info(&buffer_submit_info, &wait_submit, &signal_submit);
+    // So the render thread has something to draw straight away.
+    snapshots.back() = clock.advance(this->window);
+    snapshots.publish();
 
-        auto result = vkQueueSubmit2(device.graphics_queue(), 1, &submit_info, render_fence.vk_fence());
-        vk_check(result);
+    std::atomic<bool> stop = false;
+    std::atomic<bool> render_stopped = false;
+    std::exception_ptr render_error;
 
-        this->context.value().swapchain().present(swap_image_idx, device.graphics_queue(), render_complete);
+    std::thread render_thread([&]()
+    {
+        try
+        {
+            while (!stop.load(std::memory_order_acquire))
+            {
+                // Draws the same snapshot again if the simulation hasn't moved on since.
+                snapshots.update();
+                renderer.draw_frame(snapshots.front());
+            }
+        }
+        catch (...)
+        {
+            render_error = std::current_exception();
+        }
+
+        render_stopped.store(true, std::memory_order_release);
+    });
+
+    while (!glfwWindowShouldClose(this->window) && !render_stopped.load(std::memory_order_acquire))
+    {
+        // Sleeps until there's input or the next step is due.
+        glfwWaitEventsTimeout(clock.until_next_step());
 
-        frame_idx++;
+        snapshots.back() = clock.advance(this->window);
+        snapshots.publish();
     }
 
-    auto result = vkDeviceWaitIdle(device.device());
-    vk_check(result);
+    stop.store(true, std::memory_order_release);
+    render_thread.join();
 
-    vkDestroyCommandPool(device.device(), command_pool, nullptr);
-    vkDestroyPipelineLayout(device.device(), pipeline.layout, nullptr);
-    vkDestroyPipeline(device.device(), pipeline.pipeline, nullptr);
+    if (render_error)
+    {
+        std::rethrow_exception(render_error);
+    }
 }
 
 Window::~Window()
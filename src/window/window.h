@@ -7,10 +7,22 @@
 
 struct GLFWwindow;
 
+namespace render {
+    class Renderer;
+}
+
+enum class ThreadingMode {
+    // Events, simulation and rendering all in one loop, at the render rate.
+    SingleThreaded,
+    // Events and simulation stay on the main thread, and a render thread draws the latest snapshot of them.
+    // A GPU stall then only holds up the render thread.
+    RenderThread,
+};
+
 class Window
 {
 public:
-    Window(int width, int height, std::string_view title);
+    Window(int width, int height, std::string_view title, vk::ContextOptions options = {});
     ~Window();
     
     Window& operator=(const Window& other) = delete;
@@ -18,9 +30,12 @@ public:
 
     GLFWwindow* get_window() { return this->window; }
 
-    void run();
+    void run(ThreadingMode mode = ThreadingMode::RenderThread);
 
 private:
+    void run_single_threaded(render::Renderer& renderer);
+    void run_render_thread(render::Renderer& renderer);
+
     GLFWwindow *window = nullptr;
     std::optional<vk::Context> context;
 